@@ -21,6 +21,13 @@ SOURCES = [
     'src/binutils_hooks.cpp',
     'src/binutils_scanner.cpp',
     'src/binutils_callback.cpp',
+    'src/binutils_accessors.cpp',
+    'src/binutils_convert.cpp',
+    'src/binutils_batch.cpp',
+    'src/binutils_traversal.cpp',
+    'src/binutils_memory.cpp',
+    'src/binutils_descriptors.cpp',
+    'src/binutils_stubs.cpp',
 
     # DynamicHooks
     'src/thirdparty/DynamicHooks/DynamicHooks.cpp',
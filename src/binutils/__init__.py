@@ -109,6 +109,103 @@ class CustomType(Pointer):
     size = None
 
 
+class LazyFunction(object):
+    '''
+    Stores all information that is required to create a Function object, but
+    creates it not before it's called, one of its attributes is accessed or
+    it's used as a pointer.
+    '''
+
+    def __init__(self, binary, identifier, convention, parameters,
+            converter=lambda x: x, srv_check=True, doc=None):
+        self.binary     = binary
+        self.identifier = identifier
+        self.convention = convention
+        self.parameters = parameters
+        self.converter  = converter
+        self.srv_check  = srv_check
+        self.__doc__    = doc
+        self._function  = None
+
+        # (class, attribute name) tuples of the classes that store this
+        # object. They get the Function object after it has been resolved.
+        self._owners    = []
+
+    def resolve(self):
+        '''
+        Returns the Function object. It's created on the first call.
+        '''
+
+        if self._function is None:
+            self._function = make_function(self.binary, self.identifier,
+                self.convention, self.parameters, self.converter,
+                self.srv_check, self.__doc__)
+
+            # Later calls through the owners don't need to go through this
+            # object anymore
+            for cls, name in self._owners:
+                setattr(cls, name, self._function)
+
+        return self._function
+
+    def bind(self, cls, name):
+        '''
+        Replaces the attribute <name> of <cls> with the Function object, once
+        it has been resolved.
+        '''
+
+        if self._function is not None:
+            setattr(cls, name, self._function)
+        else:
+            self._owners.append((cls, name))
+
+    def __call__(self, *args):
+        if self._function is None:
+            self.resolve()
+
+        return self._function(*args)
+
+    def __getattr__(self, attr):
+        '''
+        Redirects all other attributes to the Function object.
+        '''
+
+        return getattr(self.resolve(), attr)
+
+    # Special methods are looked up on the type and bypass __getattr__, so
+    # everything that treats the function as a pointer is redirected here.
+    def __int__(self):
+        return int(self.resolve())
+
+    __long__ = __index__ = __int__
+
+    def __nonzero__(self):
+        return bool(self.resolve())
+
+    __bool__ = __nonzero__
+
+    def __eq__(self, other):
+        return self.resolve() == other
+
+    def __ne__(self, other):
+        return self.resolve() != other
+
+    def __hash__(self):
+        return hash(self.resolve())
+
+    def __add__(self, other):
+        return self.resolve() + other
+
+    def __radd__(self, other):
+        return other + self.resolve()
+
+    def __sub__(self, other):
+        return self.resolve() - other
+
+    def __rsub__(self, other):
+        return other - self.resolve()
+
+
 class TypeManager(dict):
     '''
     The TypeManager is an extremely powerful class, which gives you the
@@ -125,6 +222,10 @@ class TypeManager(dict):
         # Default converter -- do nothing
         self.set_default_converter(lambda x: x)
 
+        # All functions that have been created by this manager, but might not
+        # have been resolved yet
+        self.lazy_functions = []
+
     def __getattr__(self, attr):
         '''
         Redirection to TypeManager.__getitem__.
@@ -172,7 +273,12 @@ class TypeManager(dict):
         require a valid this-pointer as the first argument).
         '''
 
-        return type('Pipe', (object,), cls_dict)
+        cls = type('Pipe', (object,), cls_dict)
+        for name, value in cls_dict.items():
+            if isinstance(value, LazyFunction):
+                value.bind(cls, name)
+
+        return cls
 
     def create_pipe_from_file(self, *files):
         '''
@@ -350,11 +456,11 @@ class TypeManager(dict):
             converter_name=None, srv_check=True, convention=Convention.CDECL,
             doc=None):
         '''
-        Returns a new Function object.
+        Returns a new LazyFunction object.
         '''
 
-        return make_function(binary, identifier, convention, parameters,
-            self.create_converter(converter_name), srv_check, doc)
+        return self._lazy_function(binary, identifier, convention,
+            parameters, converter_name, srv_check, doc)
 
     def attribute(self, str_type, offset=0, length=-1, is_array=False,
             aligned=False, flags=AttrFlags.READ_WRITE, doc=None):
@@ -366,93 +472,16 @@ class TypeManager(dict):
         if length != -1 and (not is_array and str_type != 'string_array'):
             raise ValueError('A length is optional for arrays.')
 
-        converter_name = None
-        if str_type not in NATIVE_TYPES:
-            converter_name = str_type
-            str_type = 'ptr'
-
-        elif aligned and not is_array:
+        if aligned and not is_array and str_type in NATIVE_TYPES:
             raise ValueError('You cannot align an attribute of type "%s".'% \
                 str_type)
 
-        # Getter method
-        def fget(ptr_self):
-            # Handle arrays
-            if is_array:
-                # This is a check for NULL pointers and required for unaligned
-                # arrays
-                ptr_self2 = ptr_self.get_ptr(offset)
-                if aligned:
-                    ptr_self = Pointer(int(ptr_self) + offset)
-                else:
-                    ptr_self = ptr_self2
-
-                if str_type == 'ptr':
-                    return ptr_self.make_ptr_array(
-                        self[converter_name].size,
-                        length,
-                        self.create_converter(converter_name)
-                    )
-
-                return getattr(ptr_self, 'make_%s_array'% str_type)(length)
-
-            # Handle aligned data types
-            if aligned:
-                return self[converter_name](ptr_self + offset)
-
-            # Handle unaligned data types
-            result = getattr(ptr_self, 'get_' + str_type)(offset)
-            if str_type == 'ptr':
-                return self[converter_name](result)
-
-            return result
-
-        # Setter method
-        def fset(ptr_self, value):
-            # Handle arrays
-            if is_array:
-                if isinstance(value, Pointer):
-                    if length == -1:
-                        if value.length == -1:
-                            raise ValueError('Setting arrays requires a len' \
-                                'gth.')
-
-                        # If <length> is -1, but <value> has a length we are
-                        # going to use its length instead
-                        value = tuple(value)
-                    else:
-                        value = (value[x] for x in xrange(length))
-
-                # Get the array and set all values
-                array = fget(ptr_self)
-                for index, val in enumerate(value):
-                    array[index] = val
-
-                return
-
-            # Handle aligned data types
-            if aligned:
-                Pointer(value).copy(
-                    ptr_self + offset, self[converter_name].size * length
-                )
-                return
-
-            # Handle unaligned data types
-            if str_type == 'string_array':
-                ptr_self.set_string_array(value, offset, length)
-            else:
-                getattr(ptr_self, 'set_' + str_type)(value, offset)
-
-        # Return the proper property object depending on the flags
-        if flags & AttrFlags.READ_WRITE:
-            return property(fget, fset, doc=doc)
-        elif flags & AttrFlags.READ:
-            return property(fget, doc=doc)
-        elif flags & AttrFlags.WRITE:
-            return property(fset=fset, doc=doc)
-
         # Raise an error as we cannot read or write the attribute
-        raise AttributeError('Attribute is not readable or writeable.')
+        if not flags & AttrFlags.READ_WRITE:
+            raise AttributeError('Attribute is not readable or writeable.')
+
+        return Attribute(self, str_type, offset, length, is_array, aligned,
+            flags, doc)
 
     def function(self, binary, identifier, parameters, converter_name=None,
             srv_check=True, convention=Convention.THISCALL, doc=None):
@@ -460,30 +489,53 @@ class TypeManager(dict):
         Adds a function to a class.
         '''
 
-        func = helpers._EvalFunction(
-            make_function(
+        return MemberFunction(
+            self._lazy_function(
                 binary,
                 identifier,
                 convention,
                 parameters,
-                self.create_converter(converter_name),
+                converter_name,
                 srv_check
-            )
+            ),
+            doc
         )
 
-        func.__doc__ = doc
-        return func
-
     def virtual_function(self, index, parameters,
             converter_name=None, convention=Convention.THISCALL, doc=None):
         '''
         Adds a virtual function to a class.
         '''
 
-        func = helpers._EvalVirtualFunction(index, convention, parameters,
-            self.create_converter(converter_name))
+        return VirtualMemberFunction(index, convention, parameters,
+            self.create_converter(converter_name), doc)
+
+    def validate_all(self):
+        '''
+        Resolves all functions of this manager. Returns a list of
+        (<LazyFunction>, <exception>) tuples of all functions that could not
+        be resolved.
+        '''
+
+        errors = []
+        for func in self.lazy_functions:
+            try:
+                func.resolve()
+            except Exception as e:
+                errors.append((func, e))
+
+        return errors
+
+    def _lazy_function(self, binary, identifier, convention, parameters,
+            converter_name=None, srv_check=True, doc=None):
+        '''
+        Returns a new LazyFunction object and remembers it for validate_all().
+        '''
+
+        func = LazyFunction(binary, identifier, convention, parameters,
+            self.create_converter(converter_name), srv_check, doc)
 
-        func.__doc__ = doc
+        self.lazy_functions.append(func)
         return func
 
 # Create a manager that can be used by all programs
@@ -3,6 +3,8 @@
 # =============================================================================
 # Python
 import os
+import marshal
+import tempfile
 
 from configobj import ConfigObj
 
@@ -11,91 +13,19 @@ from _binutils import *
 
 
 # =============================================================================
-# >> CLASSES
+# >> CONSTANTS
 # =============================================================================
-class _EvalFunction(Function):
-    '''
-    Emulates a bound method.
-    '''
-
-    def __init__(self, func):
-        super(_EvalFunction, self).__init__(func)
-        self.is_virtual = False
-
-    def __get__(self, this, cls):
-        '''
-        Returns <self> if <this> is None. Otherwise it returns a new Thiscall
-        object.
-        '''
-
-        func = self if this is None else Thiscall(self, this, False)
-        func.__doc__ = self.__doc__
-        return func
+# Parsed data files are cached in this sub directory of the data file. Set it
+# to None to disable caching
+CACHE_DIRECTORY = '__bincache__'
 
-
-class _EvalVirtualFunction(object):
-    '''
-    Emulates a bound method. We can only evaluate the function's address if a
-    valid this-pointer was passed.
-    '''
-
-    def __init__(self, index, convention, parameters, converter):
-        self.index      = index
-        self.convention = convention
-        self.parameters = parameters
-        self.converter  = converter
-        self.is_virtual = True
-
-    def __call__(self, this, *args):
-        '''
-        This will be called when the function was accessed via the class. We
-        still have to wait for a valid this-pointer.
-        '''
-
-        return self.__eval_func(this)(*args)
-
-    def __get__(self, this, cls):
-        '''
-        Returns <self> if <this> is None. Otherwise it returns a new Thiscall
-        object.
-        '''
-
-        return self if this is None else self.__eval_func(this)
-
-    def __eval_func(self, this):
-        '''
-        Evaluates the function's address by using the given this-pointer.
-        '''
-
-        this = Pointer(this)
-        func = Thiscall(
-            this.make_virtual_function(
-                self.index,
-                self.convention,
-                self.parameters,
-                self.converter
-            ),
-            this,
-            True
-        )
-
-        func.__doc__ = self.__doc__
-        return func
-
-    def __getattr__(self, attr):
-        '''
-        Emulates the Function class by raising an error if you try to access
-        an attribute or function of the Function class.
-        '''
-
-        if attr in dir(Function):
-            raise AttributeError('This function is virtual. You need a poin' \
-                'ter to access this attribute.')
-
-        raise AttributeError('"%s" has no attribute "%s"'% (
-            self.__class__.__name__, attr))
+# Increase this number if the format of the cached data changes
+CACHE_VERSION = 1
 
 
+# =============================================================================
+# >> CLASSES
+# =============================================================================
 class Thiscall(Function):
     '''
     This class is used to emulate functions which require a this-pointer. By
@@ -140,6 +70,11 @@ def read_files(*files):
 
     data = {}
     for f in files:
+        # Only files that were passed by path can be cached
+        if isinstance(f, basestring) and CACHE_DIRECTORY is not None:
+            data.update(_read_cached_file(f))
+            continue
+
         data.update(ConfigObj(f))
         try:
             f.close()
@@ -148,6 +83,85 @@ def read_files(*files):
 
     return data
 
+def _read_cached_file(path):
+    '''
+    Returns the parsed data of the given file. The data is read from the
+    cache if the file hasn't changed since it was cached. Otherwise the file
+    is parsed and cached again.
+    '''
+
+    # ConfigObj returns an empty config for missing files, so optional data
+    # files must not raise an error here
+    try:
+        stat = os.stat(path)
+    except OSError:
+        return {}
+
+    key  = (CACHE_VERSION, stat.st_mtime, stat.st_size)
+
+    directory, name = os.path.split(os.path.abspath(path))
+    cache_path = os.path.join(directory, CACHE_DIRECTORY, name + '.marshal')
+
+    # A missing, outdated or broken cache file is not an error. We just parse
+    # the file again
+    try:
+        with open(cache_path, 'rb') as f:
+            cached_key, data = marshal.load(f)
+
+        if cached_key == key:
+            return data
+    except (IOError, OSError, EOFError, ValueError, TypeError):
+        pass
+
+    data = _to_dict(ConfigObj(path))
+
+    # The cache is optional, so ignore errors like missing write permissions
+    try:
+        _write_cache_file(cache_path, (key, data))
+    except (IOError, OSError):
+        pass
+
+    return data
+
+def _write_cache_file(cache_path, value):
+    '''
+    Writes the value to a temporary file and moves it over the cache file, so
+    readers never see a partially written cache file.
+    '''
+
+    cache_dir = os.path.dirname(cache_path)
+    if not os.path.isdir(cache_dir):
+        os.makedirs(cache_dir)
+
+    handle, temp_path = tempfile.mkstemp(dir=cache_dir, suffix='.tmp')
+    try:
+        with os.fdopen(handle, 'wb') as f:
+            marshal.dump(value, f)
+
+        # Windows can't rename over an existing file. Readers that come in
+        # between just parse the data file again
+        if os.name == 'nt' and os.path.exists(cache_path):
+            os.remove(cache_path)
+
+        os.rename(temp_path, cache_path)
+    except:
+        if os.path.exists(temp_path):
+            os.remove(temp_path)
+
+        raise
+
+def _to_dict(section):
+    '''
+    Converts a ConfigObj section recursively into a dictionary, so it can be
+    marshalled.
+    '''
+
+    result = {}
+    for key, value in section.iteritems():
+        result[key] = _to_dict(value) if isinstance(value, dict) else value
+
+    return result
+
 def parse_data(raw_data, keys):
     '''
     Parses the data dictionary by converting the values of the given keys into
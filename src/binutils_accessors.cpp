@@ -0,0 +1,340 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include "binutils_accessors.h"
+#include "binutils_convert.h"
+#include "binutils_tools.h"
+
+
+// ============================================================================
+// >> HELPER FUNCTIONS
+// ============================================================================
+inline bool HasKeywords(PyObject* kwargs)
+{
+    return kwargs && PyDict_Size(kwargs);
+}
+
+// Parses (offset=0)
+inline bool ParseGetArgs(PyObject* args, PyObject* kwargs, int& iOffset)
+{
+    iOffset = 0;
+    if (!HasKeywords(kwargs))
+    {
+        switch (PyTuple_GET_SIZE(args))
+        {
+            case 0: return true;
+            case 1: return FromPyObject<int>(PyTuple_GET_ITEM(args, 0), iOffset);
+        }
+    }
+
+    static char* s_szKeywords[] = {"offset", NULL};
+    return PyArg_ParseTupleAndKeywords(args, kwargs, "|i", s_szKeywords, &iOffset) != 0;
+}
+
+// Parses (value, offset=0)
+inline bool ParseSetArgs(PyObject* args, PyObject* kwargs, PyObject*& pValue, int& iOffset)
+{
+    iOffset = 0;
+    if (!HasKeywords(kwargs))
+    {
+        switch (PyTuple_GET_SIZE(args))
+        {
+            case 1:
+                pValue = PyTuple_GET_ITEM(args, 0);
+                return true;
+
+            case 2:
+                pValue = PyTuple_GET_ITEM(args, 0);
+                return FromPyObject<int>(PyTuple_GET_ITEM(args, 1), iOffset);
+        }
+    }
+
+    static char* s_szKeywords[] = {"value", "offset", NULL};
+    return PyArg_ParseTupleAndKeywords(args, kwargs, "O|i", s_szKeywords, &pValue, &iOffset) != 0;
+}
+
+// Returns the address of a Pointer instance or 0 if it's a NULL pointer. In
+// that case a Python exception has been set.
+inline unsigned long GetValidAddress(PyObject* self)
+{
+    CPointer* pPtr = GetPyInstance<CPointer>(self);
+    if (!pPtr || !pPtr->m_ulAddr)
+    {
+        PyErr_SetString(PyExc_ValueError, "Pointer is NULL.");
+        return 0;
+    }
+    return pPtr->m_ulAddr;
+}
+
+
+// ============================================================================
+// >> Pointer accessors
+// ============================================================================
+template<class T>
+PyObject* Pointer_Get(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    int iOffset;
+    if (!ParseGetArgs(args, kwargs, iOffset))
+        return NULL;
+
+    unsigned long ulAddr = GetValidAddress(self);
+    if (!ulAddr)
+        return NULL;
+
+    return ToPyObject<T>(*(T *) (ulAddr + iOffset));
+}
+
+template<class T>
+PyObject* Pointer_Set(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    PyObject* pValue;
+    int iOffset;
+    if (!ParseSetArgs(args, kwargs, pValue, iOffset))
+        return NULL;
+
+    T value;
+    if (!FromPyObject<T>(pValue, value))
+        return NULL;
+
+    unsigned long ulAddr = GetValidAddress(self);
+    if (!ulAddr)
+        return NULL;
+
+    *(T *) (ulAddr + iOffset) = value;
+    Py_RETURN_NONE;
+}
+
+PyObject* Pointer_GetPtr(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    int iOffset;
+    if (!ParseGetArgs(args, kwargs, iOffset))
+        return NULL;
+
+    unsigned long ulAddr = GetValidAddress(self);
+    if (!ulAddr)
+        return NULL;
+
+    return ToPyPointer(*(unsigned long *) (ulAddr + iOffset));
+}
+
+PyObject* Pointer_SetPtr(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    PyObject* pValue;
+    int iOffset;
+    if (!ParseSetArgs(args, kwargs, pValue, iOffset))
+        return NULL;
+
+    unsigned long ulValue;
+    if (!TryExtractPyPtr(pValue, ulValue))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected an address or a Pointer object.");
+        return NULL;
+    }
+
+    unsigned long ulAddr = GetValidAddress(self);
+    if (!ulAddr)
+        return NULL;
+
+    *(unsigned long *) (ulAddr + iOffset) = ulValue;
+    Py_RETURN_NONE;
+}
+
+PyObject* Pointer_GetStringArray(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    int iOffset;
+    if (!ParseGetArgs(args, kwargs, iOffset))
+        return NULL;
+
+    unsigned long ulAddr = GetValidAddress(self);
+    if (!ulAddr)
+        return NULL;
+
+    return ToPyObject<const char *>((const char *) (ulAddr + iOffset));
+}
+
+PyObject* Pointer_SetStringArray(PyObject* self, PyObject* args, PyObject* kwargs)
+{
+    static char* s_szKeywords[] = {"text", "offset", "size", NULL};
+
+    char* szText;
+    int iOffset = 0;
+    int iSize = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|ii", s_szKeywords, &szText, &iOffset, &iSize))
+        return NULL;
+
+    CPointer* pPtr = GetPyInstance<CPointer>(self);
+    try
+    {
+        pPtr->SetStringArray(szText, iOffset, iSize);
+    }
+    catch (error_already_set&)
+    {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+#define POINTER_METHOD(name, function, doc) \
+    {name, (PyCFunction) (PyCFunctionWithKeywords) function, METH_VARARGS | METH_KEYWORDS, doc}
+
+static PyMethodDef g_PointerMethods[] = {
+    // get_<type> methods
+    POINTER_METHOD("get_bool",         &Pointer_Get<bool>,               "Returns the value at the given memory location as a boolean."),
+    POINTER_METHOD("get_char",         &Pointer_Get<char>,               "Returns the value at the given memory location as a char."),
+    POINTER_METHOD("get_uchar",        &Pointer_Get<unsigned char>,      "Returns the value at the given memory location as an unsgined char."),
+    POINTER_METHOD("get_short",        &Pointer_Get<short>,              "Returns the value at the given memory location as a short."),
+    POINTER_METHOD("get_ushort",       &Pointer_Get<unsigned short>,     "Returns the value at the given memory location as a unsigned short."),
+    POINTER_METHOD("get_int",          &Pointer_Get<int>,                "Returns the value at the given memory location as an integer."),
+    POINTER_METHOD("get_uint",         &Pointer_Get<unsigned int>,       "Returns the value at the given memory location as an unsigned integer."),
+    POINTER_METHOD("get_long",         &Pointer_Get<long>,               "Returns the value at the given memory location as a long."),
+    POINTER_METHOD("get_ulong",        &Pointer_Get<unsigned long>,      "Returns the value at the given memory location as an unsigned long."),
+    POINTER_METHOD("get_long_long",    &Pointer_Get<long long>,          "Returns the value at the given memory location as a long long."),
+    POINTER_METHOD("get_ulong_long",   &Pointer_Get<unsigned long long>, "Returns the value at the given memory location as an unsigned long long."),
+    POINTER_METHOD("get_float",        &Pointer_Get<float>,              "Returns the value at the given memory location as a float."),
+    POINTER_METHOD("get_double",       &Pointer_Get<double>,             "Returns the value at the given memory location as a double."),
+    POINTER_METHOD("get_ptr",          &Pointer_GetPtr,                  "Returns the value at the given memory location as a CPointer instance."),
+    POINTER_METHOD("get_string",       &Pointer_Get<const char *>,       "Returns the value at the given memory location as a string."),
+    POINTER_METHOD("get_string_array", &Pointer_GetStringArray,          "Returns the value at the given memory location as a string."),
+
+    // set_<type> methods
+    POINTER_METHOD("set_bool",         &Pointer_Set<bool>,               "Sets the value at the given memory location as a boolean."),
+    POINTER_METHOD("set_char",         &Pointer_Set<char>,               "Sets the value at the given memory location as a char."),
+    POINTER_METHOD("set_uchar",        &Pointer_Set<unsigned char>,      "Sets the value at the given memory location as an unsigned char."),
+    POINTER_METHOD("set_short",        &Pointer_Set<short>,              "Sets the value at the given memory location as a short."),
+    POINTER_METHOD("set_ushort",       &Pointer_Set<unsigned short>,     "Sets the value at the given memory location as an unsigned short."),
+    POINTER_METHOD("set_int",          &Pointer_Set<int>,                "Sets the value at the given memory location as an integer."),
+    POINTER_METHOD("set_uint",         &Pointer_Set<unsigned int>,       "Sets the value at the given memory location as an unsigned integer."),
+    POINTER_METHOD("set_long",         &Pointer_Set<long>,               "Sets the value at the given memory location as a long."),
+    POINTER_METHOD("set_ulong",        &Pointer_Set<unsigned long>,      "Sets the value at the given memory location as an unsigned long."),
+    POINTER_METHOD("set_long_long",    &Pointer_Set<long long>,          "Sets the value at the given memory location as a long long."),
+    POINTER_METHOD("set_ulong_long",   &Pointer_Set<unsigned long long>, "Sets the value at the given memory location as an unsigned long long."),
+    POINTER_METHOD("set_float",        &Pointer_Set<float>,              "Sets the value at the given memory location as a float."),
+    POINTER_METHOD("set_double",       &Pointer_Set<double>,             "Sets the value at the given memory location as a double."),
+    POINTER_METHOD("set_ptr",          &Pointer_SetPtr,                  "Sets the value at the given memory location as a pointer."),
+    POINTER_METHOD("set_string",       &Pointer_Set<const char *>,       "Sets the value at the given memory location as a string."),
+    POINTER_METHOD("set_string_array", &Pointer_SetStringArray,          "Sets the value at the given memory location as a string."),
+
+    {NULL, NULL, 0, NULL}
+};
+
+
+// ============================================================================
+// >> Array accessors
+// ============================================================================
+// Returns the address of the item or 0 if the index is invalid. In that case
+// a Python exception has been set.
+template<class T>
+inline unsigned long GetItemAddress(PyObject* self, PyObject* pIndex)
+{
+    unsigned int uiIndex;
+    if (!FromPyObject<unsigned int>(pIndex, uiIndex))
+        return 0;
+
+    CArray<T>* pArray = GetPyInstance< CArray<T> >(self);
+    if (uiIndex >= pArray->m_iLength && pArray->m_iLength != -1)
+    {
+        PyErr_SetString(PyExc_IndexError, "Index out of range.");
+        return 0;
+    }
+
+    if (!pArray->m_ulAddr)
+    {
+        PyErr_SetString(PyExc_ValueError, "Pointer is NULL.");
+        return 0;
+    }
+    return pArray->m_ulAddr + uiIndex * pArray->m_iTypeSize;
+}
+
+template<class T>
+PyObject* Array_GetItem(PyObject* self, PyObject* pIndex)
+{
+    unsigned long ulAddr = GetItemAddress<T>(self, pIndex);
+    if (!ulAddr)
+        return NULL;
+
+    return ToPyObject<T>(*(T *) ulAddr);
+}
+
+template<class T>
+PyObject* Array_SetItem(PyObject* self, PyObject* args)
+{
+    PyObject* pIndex;
+    PyObject* pValue;
+    if (!PyArg_UnpackTuple(args, "__setitem__", 2, 2, &pIndex, &pValue))
+        return NULL;
+
+    T value;
+    if (!FromPyObject<T>(pValue, value))
+        return NULL;
+
+    unsigned long ulAddr = GetItemAddress<T>(self, pIndex);
+    if (!ulAddr)
+        return NULL;
+
+    *(T *) ulAddr = value;
+    Py_RETURN_NONE;
+}
+
+template<class T>
+void ExposeArrayAccessors(const char* szClassName)
+{
+    static PyMethodDef s_Methods[] = {
+        {"__getitem__", (PyCFunction) &Array_GetItem<T>, METH_O, "Returns the item at the given index."},
+        {"__setitem__", (PyCFunction) &Array_SetItem<T>, METH_VARARGS, "Sets the item at the given index."},
+        {NULL, NULL, 0, NULL}
+    };
+
+    AddPyMethods(scope().attr(szClassName), s_Methods);
+}
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+void AddPyMethods(object cls, PyMethodDef* pMethods)
+{
+    for (PyMethodDef* pDef = pMethods; pDef->ml_name; pDef++)
+    {
+        object descriptor = object(handle<>(PyDescr_NewMethod((PyTypeObject *) cls.ptr(), pDef)));
+        setattr(cls, pDef->ml_name, descriptor);
+    }
+}
+
+void ExposeAccessors()
+{
+    AddPyMethods(scope().attr("Pointer"), g_PointerMethods);
+
+    ExposeArrayAccessors<bool>("BoolArray");
+    ExposeArrayAccessors<char>("CharArray");
+    ExposeArrayAccessors<unsigned char>("UCharArray");
+    ExposeArrayAccessors<short>("ShortArray");
+    ExposeArrayAccessors<unsigned short>("UShortArray");
+    ExposeArrayAccessors<int>("IntArray");
+    ExposeArrayAccessors<unsigned int>("UIntArray");
+    ExposeArrayAccessors<long>("LongArray");
+    ExposeArrayAccessors<unsigned long>("ULongArray");
+    ExposeArrayAccessors<long long>("LongLongArray");
+    ExposeArrayAccessors<unsigned long long>("ULongLongArray");
+    ExposeArrayAccessors<float>("FloatArray");
+    ExposeArrayAccessors<double>("DoubleArray");
+    ExposeArrayAccessors<const char *>("StringArray");
+}
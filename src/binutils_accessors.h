@@ -0,0 +1,46 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_ACCESSORS_H
+#define _BINUTILS_ACCESSORS_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+/*
+    Adds plain CPython methods to an existing (boost.python) class. The method
+    table must stay alive until the interpreter shuts down.
+*/
+void AddPyMethods(object cls, PyMethodDef* pMethods);
+
+/*
+    Adds the get_<type>/set_<type> methods to the Pointer class and the
+    __getitem__/__setitem__ methods to the array classes. These bypass boost's
+    overload resolution and argument converters completely.
+*/
+void ExposeAccessors();
+
+#endif // _BINUTILS_ACCESSORS_H
@@ -0,0 +1,469 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string.h>
+
+#include "binutils_batch.h"
+#include "binutils_convert.h"
+#include "binutils_macros.h"
+#include "binutils_tools.h"
+
+
+// ============================================================================
+// >> DEFINITIONS
+// ============================================================================
+// Number of pointers we look ahead when prefetching
+#define PREFETCH_DISTANCE 4
+
+
+// ============================================================================
+// >> HELPER FUNCTIONS
+// ============================================================================
+template<class T>
+void GatherValues(const std::vector<unsigned long>& vecAddresses, int iOffset, void* pBuffer, bool bPrefetch)
+{
+    T* pDest = (T *) pBuffer;
+    size_t iCount = vecAddresses.size();
+    for (size_t i=0; i < iCount; i++)
+    {
+        if (bPrefetch && i + PREFETCH_DISTANCE < iCount)
+            PREFETCH(vecAddresses[i + PREFETCH_DISTANCE] + iOffset);
+
+        unsigned long ulAddr = vecAddresses[i];
+        pDest[i] = ulAddr ? *(T *) (ulAddr + iOffset) : T();
+    }
+}
+
+// <iStride> is 0 if the same value should be written to all pointers
+template<class T>
+void ScatterValues(const std::vector<unsigned long>& vecAddresses, int iOffset, const void* pBuffer, int iStride, bool bPrefetch, int& iWritten)
+{
+    const T* pValues = (const T *) pBuffer;
+    size_t iCount = vecAddresses.size();
+    for (size_t i=0; i < iCount; i++)
+    {
+        if (bPrefetch && i + PREFETCH_DISTANCE < iCount)
+            PREFETCH(vecAddresses[i + PREFETCH_DISTANCE] + iOffset);
+
+        unsigned long ulAddr = vecAddresses[i];
+        if (!ulAddr)
+            continue;
+
+        *(T *) (ulAddr + iOffset) = pValues[i * iStride];
+        iWritten++;
+    }
+}
+
+inline bool GetReadBuffer(PyObject* pObj, const void*& pBuffer, Py_ssize_t& iLength)
+{
+    // Numbers and Pointer objects don't provide a buffer, but we need to make
+    // sure that we don't leave an exception behind
+    if (!PyObject_CheckReadBuffer(pObj))
+        return false;
+
+    if (PyObject_AsReadBuffer(pObj, &pBuffer, &iLength) != 0)
+    {
+        PyErr_Clear();
+        return false;
+    }
+    return true;
+}
+
+
+template<class T>
+void GetNativeArrayData(PyObject* pObj, const void*& pData, int& iLength)
+{
+    CArray<T>* pArray = GetPyInstance< CArray<T> >(pObj);
+    if (!pArray)
+        return;
+
+    if (pArray->m_iLength == -1)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Array has no length.")
+
+    if (!pArray->m_ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
+
+    pData = (const void *) pArray->m_ulAddr;
+    iLength = pArray->m_iLength;
+}
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+void ExtractAddresses(object oPtrs, std::vector<unsigned long>& vecAddresses)
+{
+    PyObject* pPtrs = oPtrs.ptr();
+
+    // The items of a PtrArray are stored inline. So, we need their addresses
+    CPtrArray* pPtrArray = GetPyInstance<CPtrArray>(pPtrs);
+    if (pPtrArray)
+    {
+        if (pPtrArray->m_iLength == -1)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Array has no length.")
+
+        vecAddresses.reserve(pPtrArray->m_iLength);
+        for (int i=0; i < pPtrArray->m_iLength; i++)
+            vecAddresses.push_back(pPtrArray->m_ulAddr + i * pPtrArray->m_iTypeSize);
+
+        return;
+    }
+
+    // Arrays of addresses
+    CArray<unsigned long>* pArray = GetPyInstance< CArray<unsigned long> >(pPtrs);
+    if (pArray)
+    {
+        if (pArray->m_iLength == -1)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Array has no length.")
+
+        if (!pArray->m_ulAddr)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
+
+        unsigned long* pAddresses = (unsigned long *) pArray->m_ulAddr;
+        vecAddresses.assign(pAddresses, pAddresses + pArray->m_iLength);
+        return;
+    }
+
+    const void* pBuffer;
+    Py_ssize_t iLength;
+    if (GetReadBuffer(pPtrs, pBuffer, iLength))
+    {
+        if (iLength % sizeof(unsigned long))
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Buffer size is not a multiple of the pointer size.")
+
+        unsigned long* pAddresses = (unsigned long *) pBuffer;
+        vecAddresses.assign(pAddresses, pAddresses + iLength / sizeof(unsigned long));
+        return;
+    }
+
+    // Any other sequence
+    object oSequence = object(handle<>(PySequence_Fast(pPtrs, "Expected a sequence of pointers.")));
+    Py_ssize_t iCount = PySequence_Fast_GET_SIZE(oSequence.ptr());
+    PyObject** pItems = PySequence_Fast_ITEMS(oSequence.ptr());
+
+    vecAddresses.resize(iCount);
+    for (Py_ssize_t i=0; i < iCount; i++)
+        vecAddresses[i] = ExtractPyPtr(pItems[i]);
+}
+
+int ExtractValues(object oValues, NativeType_t eType, std::vector<unsigned char>& vecValues, const void*& pValues)
+{
+    PyObject* pObj = oValues.ptr();
+    int iSize = GetNativeTypeSize(eType);
+
+    if (eType == NATIVE_PTR)
+    {
+        unsigned long ulAddr;
+        if (TryExtractPyPtr(pObj, ulAddr))
+        {
+            vecValues.resize(sizeof(unsigned long));
+            memcpy(&vecValues[0], &ulAddr, sizeof(unsigned long));
+            pValues = &vecValues[0];
+            return -1;
+        }
+
+        std::vector<unsigned long> vecAddresses;
+        ExtractAddresses(oValues, vecAddresses);
+        vecValues.resize(vecAddresses.size() * sizeof(unsigned long));
+        if (!vecAddresses.empty())
+            memcpy(&vecValues[0], &vecAddresses[0], vecValues.size());
+
+        pValues = vecValues.empty() ? NULL : &vecValues[0];
+        return (int) vecAddresses.size();
+    }
+
+    int iLength = -1;
+    NATIVE_TYPE_DISPATCH(eType, GetNativeArrayData, pObj, pValues, iLength)
+    if (iLength != -1)
+        return iLength;
+
+    Py_ssize_t iBufferLength;
+    if (GetReadBuffer(pObj, pValues, iBufferLength))
+    {
+        if (iBufferLength % iSize)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Buffer size is not a multiple of the type size.")
+
+        return (int) (iBufferLength / iSize);
+    }
+
+    if (PySequence_Check(pObj))
+    {
+        object oSequence = object(handle<>(PySequence_Fast(pObj, "Expected a sequence.")));
+        Py_ssize_t iCount = PySequence_Fast_GET_SIZE(oSequence.ptr());
+        PyObject** pItems = PySequence_Fast_ITEMS(oSequence.ptr());
+
+        vecValues.resize(iCount * iSize);
+        for (Py_ssize_t i=0; i < iCount; i++)
+        {
+            if (!WriteNativeValue(eType, (unsigned long) &vecValues[i * iSize], pItems[i]))
+                throw_error_already_set();
+        }
+
+        pValues = vecValues.empty() ? NULL : &vecValues[0];
+        return (int) iCount;
+    }
+
+    // A single value
+    vecValues.resize(iSize);
+    if (!WriteNativeValue(eType, (unsigned long) &vecValues[0], pObj))
+        throw_error_already_set();
+
+    pValues = &vecValues[0];
+    return -1;
+}
+
+object CreatePyArray(NativeType_t eType, object oBuffer)
+{
+    char szTypeCode[2] = {GetArrayTypeCode(eType), '\0'};
+    if (!szTypeCode[0])
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported by the array module.")
+
+    // Never freed, because it's required until the interpreter shuts down
+    static PyObject* s_pArrayType = NULL;
+    if (!s_pArrayType)
+    {
+        object oArrayType = import("array").attr("array");
+        s_pArrayType = incref(oArrayType.ptr());
+    }
+
+    return object(handle<>(borrowed(s_pArrayType)))(szTypeCode, oBuffer);
+}
+
+object CreatePyArray(NativeType_t eType, const void* pData, size_t iCount)
+{
+    object oBuffer = object(handle<>(PyBytes_FromStringAndSize((const char *) pData, iCount * GetNativeTypeSize(eType))));
+    return CreatePyArray(eType, oBuffer);
+}
+
+object Gather(object oPtrs, int iOffset, const char* szType, bool bPrefetch /* = true */)
+{
+    NativeType_t eType = ExtractNativeType(szType);
+    if (!GetArrayTypeCode(eType))
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported by the array module.")
+
+    std::vector<unsigned long> vecAddresses;
+    ExtractAddresses(oPtrs, vecAddresses);
+
+    object oBuffer = object(handle<>(PyBytes_FromStringAndSize(NULL, vecAddresses.size() * GetNativeTypeSize(eType))));
+    void* pDest = PyBytes_AS_STRING(oBuffer.ptr());
+
+    NATIVE_TYPE_DISPATCH(eType, GatherValues, vecAddresses, iOffset, pDest, bPrefetch)
+    return CreatePyArray(eType, oBuffer);
+}
+
+int Scatter(object oPtrs, int iOffset, const char* szType, object oValues, bool bPrefetch /* = true */)
+{
+    NativeType_t eType = ExtractNativeType(szType);
+    int iSize = GetNativeTypeSize(eType);
+
+    std::vector<unsigned long> vecAddresses;
+    ExtractAddresses(oPtrs, vecAddresses);
+    if (vecAddresses.empty())
+        return 0;
+
+    const void* pValues;
+    int iStride = 1;
+
+    // Holds the converted values if no buffer was passed
+    std::vector<unsigned char> vecValues;
+
+    unsigned long ulValue;
+    Py_ssize_t iLength;
+    if (eType == NATIVE_PTR && TryExtractPyPtr(oValues.ptr(), ulValue))
+    {
+        // Pointer objects are sequences as well, but a single pointer is
+        // written to all pointers
+        vecValues.resize(iSize);
+        memcpy(&vecValues[0], &ulValue, iSize);
+        pValues = &vecValues[0];
+        iStride = 0;
+    }
+    else if (GetReadBuffer(oValues.ptr(), pValues, iLength))
+    {
+        if (iLength != (Py_ssize_t) (vecAddresses.size() * iSize))
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Buffer size does not match the number of pointers.")
+    }
+    else if (PySequence_Check(oValues.ptr()))
+    {
+        if (len(oValues) != vecAddresses.size())
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Number of values does not match the number of pointers.")
+
+        vecValues.resize(vecAddresses.size() * iSize);
+        for (size_t i=0; i < vecAddresses.size(); i++)
+        {
+            if (!WriteNativeValue(eType, (unsigned long) &vecValues[i * iSize], object(oValues[i]).ptr()))
+                throw_error_already_set();
+        }
+        pValues = &vecValues[0];
+    }
+    else
+    {
+        // A single value for all pointers
+        vecValues.resize(iSize);
+        if (!WriteNativeValue(eType, (unsigned long) &vecValues[0], oValues.ptr()))
+            throw_error_already_set();
+
+        pValues = &vecValues[0];
+        iStride = 0;
+    }
+
+    int iWritten = 0;
+    NATIVE_TYPE_DISPATCH(eType, ScatterValues, vecAddresses, iOffset, pValues, iStride, bPrefetch, iWritten)
+    return iWritten;
+}
+
+
+// ============================================================================
+// >> CReadPlan
+// ============================================================================
+// Returns the struct module format character of the given type or 0 if the
+// type can't be read into the buffer. Pointers are read as their address.
+inline char GetStructFormat(NativeType_t eType)
+{
+    switch (eType)
+    {
+        case NATIVE_BOOL:    return '?';
+        case NATIVE_CHAR:    return 'b';
+        case NATIVE_UCHAR:   return 'B';
+        case NATIVE_FLOAT:   return 'f';
+        case NATIVE_DOUBLE:  return 'd';
+        case NATIVE_STRING:
+        case NATIVE_INVALID: return 0;
+        default: break;
+    }
+
+    // The format uses standard sizes, so choose the code by the native size
+    bool bSigned = eType == NATIVE_SHORT || eType == NATIVE_INT || eType == NATIVE_LONG || eType == NATIVE_LONG_LONG;
+    switch (GetNativeTypeSize(eType))
+    {
+        case 2: return bSigned ? 'h' : 'H';
+        case 4: return bSigned ? 'i' : 'I';
+        case 8: return bSigned ? 'q' : 'Q';
+    }
+    return 0;
+}
+
+CReadPlan::CReadPlan()
+{
+    m_oBuffer = object(handle<>(PyByteArray_FromStringAndSize(NULL, 0)));
+    m_szFormat = "=";
+}
+
+int CReadPlan::Add(object oBase, object oOffsets, const char* szType)
+{
+    ReadEntry_t entry;
+    entry.m_ulBase = ExtractPyPtr(oBase);
+    if (!entry.m_ulBase)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Base pointer is NULL.")
+
+    entry.m_eType = ExtractNativeType(szType);
+    char cFormat = GetStructFormat(entry.m_eType);
+    if (!cFormat)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported.")
+
+    entry.m_iSize = GetNativeTypeSize(entry.m_eType);
+    entry.m_ulFirstLink = 0;
+    entry.m_ulResolved = 0;
+
+    if (PySequence_Check(oOffsets.ptr()))
+    {
+        for (int i=0; i < len(oOffsets); i++)
+            entry.m_vecOffsets.push_back(extract<int>(oOffsets[i]));
+    }
+    else
+        entry.m_vecOffsets.push_back(extract<int>(oOffsets));
+
+    if (entry.m_vecOffsets.empty())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "At least one offset is required.")
+
+    // Align the value to its size
+    size_t iOffset = PyByteArray_GET_SIZE(m_oBuffer.ptr());
+    size_t iPadding = (entry.m_iSize - iOffset % entry.m_iSize) % entry.m_iSize;
+    entry.m_iBufferOffset = iOffset + iPadding;
+
+    // Fails if there are memoryviews of the buffer
+    if (PyByteArray_Resize(m_oBuffer.ptr(), entry.m_iBufferOffset + entry.m_iSize) != 0)
+        throw_error_already_set();
+
+    memset(PyByteArray_AS_STRING(m_oBuffer.ptr()) + iOffset, 0, iPadding + entry.m_iSize);
+
+    for (size_t i=0; i < iPadding; i++)
+        m_szFormat += 'x';
+
+    m_szFormat += cFormat;
+    m_vecEntries.push_back(entry);
+    return (int) m_vecEntries.size() - 1;
+}
+
+unsigned long CReadPlan::Resolve(ReadEntry_t& entry)
+{
+    std::vector<int>& vecOffsets = entry.m_vecOffsets;
+    size_t iLast = vecOffsets.size() - 1;
+    if (!iLast)
+        return entry.m_ulBase + vecOffsets[0];
+
+    unsigned long ulFirstLink = *(unsigned long *) (entry.m_ulBase + vecOffsets[0]);
+    if (ulFirstLink == entry.m_ulFirstLink)
+        return entry.m_ulResolved;
+
+    unsigned long ulAddr = ulFirstLink;
+    for (size_t i=1; i < iLast && ulAddr; i++)
+        ulAddr = *(unsigned long *) (ulAddr + vecOffsets[i]);
+
+    entry.m_ulFirstLink = ulFirstLink;
+    entry.m_ulResolved = ulAddr ? ulAddr + vecOffsets[iLast] : 0;
+    return entry.m_ulResolved;
+}
+
+int CReadPlan::Refresh()
+{
+    char* pBuffer = PyByteArray_AS_STRING(m_oBuffer.ptr());
+
+    int iValid = 0;
+    for (size_t i=0; i < m_vecEntries.size(); i++)
+    {
+        ReadEntry_t& entry = m_vecEntries[i];
+        unsigned long ulAddr = Resolve(entry);
+        if (ulAddr)
+        {
+            memcpy(pBuffer + entry.m_iBufferOffset, (void *) ulAddr, entry.m_iSize);
+            iValid++;
+        }
+        else
+            memset(pBuffer + entry.m_iBufferOffset, 0, entry.m_iSize);
+    }
+    return iValid;
+}
+
+void CReadPlan::Invalidate()
+{
+    for (size_t i=0; i < m_vecEntries.size(); i++)
+    {
+        m_vecEntries[i].m_ulFirstLink = 0;
+        m_vecEntries[i].m_ulResolved = 0;
+    }
+}
+
+object CReadPlan::GetView()
+{
+    return object(handle<>(PyMemoryView_FromObject(m_oBuffer.ptr())));
+}
@@ -0,0 +1,133 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_BATCH_H
+#define _BINUTILS_BATCH_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string>
+#include <vector>
+
+#include "binutils_convert.h"
+
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+/*
+    Fills the vector with the addresses of the given object. Accepted are:
+    - PtrArray: the addresses of its items
+    - ULongArray: the stored addresses
+    - buffers (e.g. array.array('L')): the stored addresses
+    - any other sequence of addresses or Pointer objects
+    Arrays require a known length.
+*/
+void ExtractAddresses(object oPtrs, std::vector<unsigned long>& vecAddresses);
+
+/*
+    Converts the given object into native values of the given type. Accepted
+    are native arrays, buffers and sequences. Pointers are extracted like
+    ExtractAddresses() does it. Any other object is a single value.
+
+    Returns the number of values or -1 if a single value was passed. <pValues>
+    points either into the object or into <vecValues> afterwards.
+*/
+int ExtractValues(object oValues, NativeType_t eType, std::vector<unsigned char>& vecValues, const void*& pValues);
+
+/*
+    Returns a new array.array object of the given type, which contains the
+    raw data of the given buffer.
+*/
+object CreatePyArray(NativeType_t eType, object oBuffer);
+
+/*
+    Same like above, but copies <iCount> values from the given memory block.
+*/
+object CreatePyArray(NativeType_t eType, const void* pData, size_t iCount);
+
+/*
+    Reads the value at <ptr + offset> for every pointer and returns them as an
+    array.array object. NULL pointers result in a zero value.
+*/
+object Gather(object oPtrs, int iOffset, const char* szType, bool bPrefetch = true);
+
+/*
+    Writes the values to <ptr + offset> for every pointer. <values> can be a
+    buffer, a sequence with a value for every pointer or a single value that
+    is written to all pointers. NULL pointers are skipped. Returns the number
+    of written values.
+*/
+int Scatter(object oPtrs, int iOffset, const char* szType, object oValues, bool bPrefetch = true);
+
+
+// ============================================================================
+// >> CReadPlan
+// ============================================================================
+struct ReadEntry_t
+{
+    unsigned long    m_ulBase;
+
+    // All offsets except the last one are dereferenced
+    std::vector<int> m_vecOffsets;
+
+    NativeType_t     m_eType;
+    int              m_iSize;
+    size_t           m_iBufferOffset;
+
+    // The first pointer of the chain and the address it resolved to. The chain
+    // is only resolved again if the first pointer changes.
+    unsigned long    m_ulFirstLink;
+    unsigned long    m_ulResolved;
+};
+
+/*
+    Reads a fixed set of values into a preallocated buffer with a single call
+    to Refresh(). Values are stored in the order they were added and aligned
+    to their size, so the buffer can be unpacked with struct.unpack_from()
+    using the format returned by GetFormat().
+*/
+class CReadPlan
+{
+public:
+    CReadPlan();
+
+    int    Add(object oBase, object oOffsets, const char* szType);
+    int    Refresh();
+    void   Invalidate();
+
+    object GetBuffer() { return m_oBuffer; }
+    object GetView();
+    const char* GetFormat() { return m_szFormat.c_str(); }
+    int    GetLength() { return (int) m_vecEntries.size(); }
+
+private:
+    unsigned long Resolve(ReadEntry_t& entry);
+
+private:
+    std::vector<ReadEntry_t> m_vecEntries;
+    object                   m_oBuffer;
+    std::string              m_szFormat;
+};
+
+#endif // _BINUTILS_BATCH_H
@@ -40,9 +40,8 @@ CCallback::CCallback(object oCallback, Convention_t eConv, char* szParams)
     m_oCallback = oCallback;
 
     // Parse the parameter string
-    m_pParams = new Param_t;
     m_pRetParam = new Param_t;
-    ParseParams(eConv, szParams, m_pParams, m_pRetParam);
+    m_iArgumentCount = ParseParams(eConv, szParams, &m_pParams, m_pRetParam);
 
     // Find the proper callback caller function
     void* pCallCallbackFunc = NULL;
@@ -93,45 +92,22 @@ CCallback::CCallback(object oCallback, Convention_t eConv, char* szParams)
 
 CCallback::~CCallback()
 {
-    delete m_pParams;
+    delete[] m_pParams;
     delete m_pRetParam;
 }
 
 int CCallback::GetPopSize()
 {
 #ifdef _WIN32
-    if (m_eConv == CONV_THISCALL || m_eConv == CONV_STDCALL)
+    if ((m_eConv == CONV_THISCALL || m_eConv == CONV_STDCALL) && m_iArgumentCount > 0)
     {
-        Param_t* pParam = GetArgument(GetArgumentCount() - 1);
+        Param_t* pParam = GetArgument(m_iArgumentCount - 1);
         return pParam->m_iOffset + pParam->m_iSize;
     }
 #endif
     return 0;
 }
 
-int CCallback::GetArgumentCount()
-{
-    int count = 0;
-    Param_t* temp = m_pParams;
-    while(temp)
-    {
-        count++;
-        temp = temp->m_pNext;
-    }
-        return count - 1;
-}
-
-Param_t* CCallback::GetArgument(int iIndex)
-{
-    Param_t* temp = m_pParams;
-    while(temp && iIndex > 0)
-    {
-        iIndex--;
-        temp = temp->m_pNext;
-    }
-    return temp;
-}
-
 void CCallback::Free()
 {
     // TODO: Figure out how to use std::free() on the generated code
@@ -151,7 +127,7 @@ T GetArgument(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX, in
         return *(T *) &ulECX;
 #endif
 
-    return *(T *) (ulEBP + pCallback->GetArgument(iIndex)->m_iOffset + 8);
+    return *(T *) (ulEBP + pCallback->m_pParams[iIndex].m_iOffset + 8);
 }
 
 object CallCallback(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX)
@@ -159,10 +135,11 @@ object CallCallback(CCallback* pCallback, unsigned long ulEBP, unsigned long ulE
     BEGIN_BOOST_PY()
 
         list arg_list;
-        for(int i=0; i < pCallback->GetArgumentCount(); i++)
+        int iArgumentCount = pCallback->GetArgumentCount();
+        for(int i=0; i < iArgumentCount; i++)
         {
             object val;
-            switch(pCallback->GetArgument(i)->m_cParam)
+            switch(pCallback->m_pParams[i].m_cParam)
             {
                 case SIGCHAR_BOOL:      val = object(GetArgument<bool>(pCallback, ulEBP, ulECX, i)); break;
                 case SIGCHAR_CHAR:      val = object(GetArgument<char>(pCallback, ulEBP, ulECX, i)); break;
@@ -34,21 +34,26 @@ class CCallback;
 
 object CallCallback(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX);
 
+// The native code might call us without the GIL (e.g. a Function with
+// release_gil=True), so it's acquired for every call
 template<class T>
 T CallbackCaller(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX)
 {
+    CGILGuard guard;
     return extract<T>(CallCallback(pCallback, ulEBP, ulECX));
 }
 
 template<>
 inline void CallbackCaller(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX)
 {
+    CGILGuard guard;
     CallCallback(pCallback, ulEBP, ulECX);
 }
 
 template<>
 inline void* CallbackCaller(CCallback* pCallback, unsigned long ulEBP, unsigned long ulECX)
 {
+    CGILGuard guard;
     return (void *) ExtractPyPtr(CallCallback(pCallback, ulEBP, ulECX));
 }
 
@@ -63,14 +68,15 @@ public:
     ~CCallback();
 
     int      GetPopSize();
-    int      GetArgumentCount();
-    Param_t* GetArgument(int iIndex);
+    int      GetArgumentCount() { return m_iArgumentCount; }
+    Param_t* GetArgument(int iIndex) { return &m_pParams[iIndex]; }
     void     Free();
 
 public:
     // For variadic functions
     object        m_oCallback;
     Param_t*      m_pParams;
+    int           m_iArgumentCount;
     Param_t*      m_pRetParam;
 };
 
@@ -0,0 +1,168 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string.h>
+
+#include "binutils_convert.h"
+#include "binutils_macros.h"
+
+
+// ============================================================================
+// >> NativeType_t
+// ============================================================================
+struct NativeTypeInfo_t
+{
+    const char* m_szName;
+    int         m_iSize;
+    char        m_cArrayTypeCode;
+};
+
+#if PYTHON_VERSION == 3
+    #define ARRAY_TYPECODE_CHAR      'b'
+    #define ARRAY_TYPECODE_LONGLONG  'q'
+    #define ARRAY_TYPECODE_ULONGLONG 'Q'
+#else
+    #define ARRAY_TYPECODE_CHAR      'c'
+    #define ARRAY_TYPECODE_LONGLONG  0
+    #define ARRAY_TYPECODE_ULONGLONG 0
+#endif
+
+// Must be in the same order like NativeType_t
+static NativeTypeInfo_t g_NativeTypes[] = {
+    {"bool",       sizeof(bool),               'B'},
+    {"char",       sizeof(char),               ARRAY_TYPECODE_CHAR},
+    {"uchar",      sizeof(unsigned char),      'B'},
+    {"short",      sizeof(short),              'h'},
+    {"ushort",     sizeof(unsigned short),     'H'},
+    {"int",        sizeof(int),                'i'},
+    {"uint",       sizeof(unsigned int),       'I'},
+    {"long",       sizeof(long),               'l'},
+    {"ulong",      sizeof(unsigned long),      'L'},
+    {"long_long",  sizeof(long long),          ARRAY_TYPECODE_LONGLONG},
+    {"ulong_long", sizeof(unsigned long long), ARRAY_TYPECODE_ULONGLONG},
+    {"float",      sizeof(float),              'f'},
+    {"double",     sizeof(double),             'd'},
+    {"ptr",        sizeof(unsigned long),      'L'},
+    {"string",     sizeof(const char *),       0}
+};
+
+NativeType_t GetNativeType(const char* szName)
+{
+    for (int i=0; i < NATIVE_INVALID; i++)
+    {
+        if (strcmp(g_NativeTypes[i].m_szName, szName) == 0)
+            return (NativeType_t) i;
+    }
+    return NATIVE_INVALID;
+}
+
+NativeType_t ExtractNativeType(const char* szName)
+{
+    NativeType_t eType = GetNativeType(szName);
+    if (eType == NATIVE_INVALID)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Unknown native type.")
+
+    return eType;
+}
+
+int GetNativeTypeSize(NativeType_t eType)
+{
+    return eType < NATIVE_INVALID ? g_NativeTypes[eType].m_iSize : 0;
+}
+
+char GetArrayTypeCode(NativeType_t eType)
+{
+    return eType < NATIVE_INVALID ? g_NativeTypes[eType].m_cArrayTypeCode : 0;
+}
+
+PyObject* ReadNativeValue(NativeType_t eType, unsigned long ulAddr)
+{
+    switch (eType)
+    {
+        case NATIVE_BOOL:       return ToPyObject<bool>(*(bool *) ulAddr);
+        case NATIVE_CHAR:       return ToPyObject<char>(*(char *) ulAddr);
+        case NATIVE_UCHAR:      return ToPyObject<unsigned char>(*(unsigned char *) ulAddr);
+        case NATIVE_SHORT:      return ToPyObject<short>(*(short *) ulAddr);
+        case NATIVE_USHORT:     return ToPyObject<unsigned short>(*(unsigned short *) ulAddr);
+        case NATIVE_INT:        return ToPyObject<int>(*(int *) ulAddr);
+        case NATIVE_UINT:       return ToPyObject<unsigned int>(*(unsigned int *) ulAddr);
+        case NATIVE_LONG:       return ToPyObject<long>(*(long *) ulAddr);
+        case NATIVE_ULONG:      return ToPyObject<unsigned long>(*(unsigned long *) ulAddr);
+        case NATIVE_LONG_LONG:  return ToPyObject<long long>(*(long long *) ulAddr);
+        case NATIVE_ULONG_LONG: return ToPyObject<unsigned long long>(*(unsigned long long *) ulAddr);
+        case NATIVE_FLOAT:      return ToPyObject<float>(*(float *) ulAddr);
+        case NATIVE_DOUBLE:     return ToPyObject<double>(*(double *) ulAddr);
+        case NATIVE_PTR:        return ToPyPointer(*(unsigned long *) ulAddr);
+        case NATIVE_STRING:     return ToPyObject<const char *>(*(const char **) ulAddr);
+        default: break;
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown native type.");
+    return NULL;
+}
+
+template<class T>
+inline bool WriteValue(unsigned long ulAddr, PyObject* pValue)
+{
+    T value;
+    if (!FromPyObject<T>(pValue, value))
+        return false;
+
+    *(T *) ulAddr = value;
+    return true;
+}
+
+bool WriteNativeValue(NativeType_t eType, unsigned long ulAddr, PyObject* pValue)
+{
+    switch (eType)
+    {
+        case NATIVE_BOOL:       return WriteValue<bool>(ulAddr, pValue);
+        case NATIVE_CHAR:       return WriteValue<char>(ulAddr, pValue);
+        case NATIVE_UCHAR:      return WriteValue<unsigned char>(ulAddr, pValue);
+        case NATIVE_SHORT:      return WriteValue<short>(ulAddr, pValue);
+        case NATIVE_USHORT:     return WriteValue<unsigned short>(ulAddr, pValue);
+        case NATIVE_INT:        return WriteValue<int>(ulAddr, pValue);
+        case NATIVE_UINT:       return WriteValue<unsigned int>(ulAddr, pValue);
+        case NATIVE_LONG:       return WriteValue<long>(ulAddr, pValue);
+        case NATIVE_ULONG:      return WriteValue<unsigned long>(ulAddr, pValue);
+        case NATIVE_LONG_LONG:  return WriteValue<long long>(ulAddr, pValue);
+        case NATIVE_ULONG_LONG: return WriteValue<unsigned long long>(ulAddr, pValue);
+        case NATIVE_FLOAT:      return WriteValue<float>(ulAddr, pValue);
+        case NATIVE_DOUBLE:     return WriteValue<double>(ulAddr, pValue);
+        case NATIVE_STRING:     return WriteValue<const char *>(ulAddr, pValue);
+        case NATIVE_PTR:
+        {
+            unsigned long ulValue;
+            if (!TryExtractPyPtr(pValue, ulValue))
+            {
+                PyErr_SetString(PyExc_TypeError, "Expected an address or a Pointer object.");
+                return false;
+            }
+            *(unsigned long *) ulAddr = ulValue;
+            return true;
+        }
+        default: break;
+    }
+
+    PyErr_SetString(PyExc_ValueError, "Unknown native type.");
+    return false;
+}
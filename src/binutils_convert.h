@@ -0,0 +1,329 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_CONVERT_H
+#define _BINUTILS_CONVERT_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <limits>
+#include "binutils_tools.h"
+
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// These functions convert native values directly from and to Python objects.
+// They are used by all hot paths that don't want to pay for boost's converter
+// lookup. Unusual objects are still passed to boost, so the behaviour is the
+// same like using extract<T>() or object(T).
+//
+// ToPyObject<T>() returns a new reference or NULL if an error occured.
+// FromPyObject<T>() returns false and sets a Python error if the conversion
+// failed. Neither of them throws a C++ exception.
+// ============================================================================
+template<class T>
+inline bool FromPyFallback(PyObject* pObj, T& value)
+{
+    extract<T> ex(pObj);
+    if (!ex.check())
+    {
+        PyErr_Format(PyExc_TypeError, "Unable to convert an object of type \"%s\".", Py_TYPE(pObj)->tp_name);
+        return false;
+    }
+
+    try
+    {
+        value = ex();
+    }
+    catch (error_already_set&)
+    {
+        return false;
+    }
+    return true;
+}
+
+inline bool IsPyInteger(PyObject* pObj)
+{
+#if PYTHON_VERSION != 3
+    if (PyInt_Check(pObj))
+        return true;
+#endif
+    return PyLong_Check(pObj) && !PyBool_Check(pObj);
+}
+
+template<class T>
+inline bool FromPySigned(PyObject* pObj, T& value)
+{
+    if (!IsPyInteger(pObj))
+        return FromPyFallback<T>(pObj, value);
+
+    PY_LONG_LONG llValue = PyLong_AsLongLong(pObj);
+    if (llValue == -1 && PyErr_Occurred())
+        return false;
+
+    if (llValue < (PY_LONG_LONG) std::numeric_limits<T>::min() || llValue > (PY_LONG_LONG) std::numeric_limits<T>::max())
+    {
+        PyErr_SetString(PyExc_OverflowError, "Value is out of range.");
+        return false;
+    }
+
+    value = (T) llValue;
+    return true;
+}
+
+template<class T>
+inline bool FromPyUnsigned(PyObject* pObj, T& value)
+{
+    if (!IsPyInteger(pObj))
+        return FromPyFallback<T>(pObj, value);
+
+    unsigned PY_LONG_LONG ullValue;
+#if PYTHON_VERSION != 3
+    if (PyInt_Check(pObj))
+    {
+        long lValue = PyInt_AS_LONG(pObj);
+        if (lValue < 0)
+        {
+            PyErr_SetString(PyExc_OverflowError, "Value is out of range.");
+            return false;
+        }
+        ullValue = (unsigned PY_LONG_LONG) lValue;
+    }
+    else
+#endif
+    {
+        ullValue = PyLong_AsUnsignedLongLong(pObj);
+        if (ullValue == (unsigned PY_LONG_LONG) -1 && PyErr_Occurred())
+            return false;
+    }
+
+    if (ullValue > (unsigned PY_LONG_LONG) std::numeric_limits<T>::max())
+    {
+        PyErr_SetString(PyExc_OverflowError, "Value is out of range.");
+        return false;
+    }
+
+    value = (T) ullValue;
+    return true;
+}
+
+template<class T>
+inline bool FromPyFloat(PyObject* pObj, T& value)
+{
+    if (PyFloat_Check(pObj))
+    {
+        value = (T) PyFloat_AS_DOUBLE(pObj);
+        return true;
+    }
+
+    if (IsPyInteger(pObj))
+    {
+        // PyFloat_AsDouble() also accepts Python 2 ints, which
+        // PyLong_AsDouble() doesn't
+        double dValue = PyFloat_AsDouble(pObj);
+        if (dValue == -1.0 && PyErr_Occurred())
+            return false;
+
+        value = (T) dValue;
+        return true;
+    }
+    return FromPyFallback<T>(pObj, value);
+}
+
+template<class T>
+inline bool FromPyObject(PyObject* pObj, T& value)
+{
+    return FromPyFallback<T>(pObj, value);
+}
+
+#define FROM_PY_OBJECT(type, function) \
+    template<> \
+    inline bool FromPyObject(PyObject* pObj, type& value) \
+    { return function<type>(pObj, value); }
+
+FROM_PY_OBJECT(short, FromPySigned)
+FROM_PY_OBJECT(unsigned short, FromPyUnsigned)
+FROM_PY_OBJECT(int, FromPySigned)
+FROM_PY_OBJECT(unsigned int, FromPyUnsigned)
+FROM_PY_OBJECT(long, FromPySigned)
+FROM_PY_OBJECT(unsigned long, FromPyUnsigned)
+FROM_PY_OBJECT(long long, FromPySigned)
+FROM_PY_OBJECT(unsigned long long, FromPyUnsigned)
+FROM_PY_OBJECT(unsigned char, FromPyUnsigned)
+FROM_PY_OBJECT(float, FromPyFloat)
+FROM_PY_OBJECT(double, FromPyFloat)
+
+template<>
+inline bool FromPyObject(PyObject* pObj, bool& value)
+{
+    if (pObj == Py_True || pObj == Py_False)
+    {
+        value = pObj == Py_True;
+        return true;
+    }
+    return FromPyFallback<bool>(pObj, value);
+}
+
+template<>
+inline bool FromPyObject(PyObject* pObj, const char*& value)
+{
+    if (pObj == Py_None)
+    {
+        value = NULL;
+        return true;
+    }
+
+#if PYTHON_VERSION != 3
+    if (PyString_Check(pObj))
+    {
+        value = PyString_AS_STRING(pObj);
+        return true;
+    }
+#endif
+    return FromPyFallback<const char *>(pObj, value);
+}
+
+template<class T>
+inline PyObject* ToPyObject(T value)
+{
+    return incref(object(value).ptr());
+}
+
+#define TO_PY_OBJECT(type, expression) \
+    template<> \
+    inline PyObject* ToPyObject(type value) \
+    { return expression; }
+
+#if PYTHON_VERSION != 3
+TO_PY_OBJECT(short, PyInt_FromLong(value))
+TO_PY_OBJECT(unsigned short, PyInt_FromLong(value))
+TO_PY_OBJECT(int, PyInt_FromLong(value))
+TO_PY_OBJECT(long, PyInt_FromLong(value))
+TO_PY_OBJECT(unsigned char, PyInt_FromLong(value))
+TO_PY_OBJECT(unsigned int, value > (unsigned long) LONG_MAX ? PyLong_FromUnsignedLong(value) : PyInt_FromLong(value))
+TO_PY_OBJECT(unsigned long, value > (unsigned long) LONG_MAX ? PyLong_FromUnsignedLong(value) : PyInt_FromLong(value))
+#else
+TO_PY_OBJECT(short, PyLong_FromLong(value))
+TO_PY_OBJECT(unsigned short, PyLong_FromLong(value))
+TO_PY_OBJECT(int, PyLong_FromLong(value))
+TO_PY_OBJECT(long, PyLong_FromLong(value))
+TO_PY_OBJECT(unsigned char, PyLong_FromLong(value))
+TO_PY_OBJECT(unsigned int, PyLong_FromUnsignedLong(value))
+TO_PY_OBJECT(unsigned long, PyLong_FromUnsignedLong(value))
+#endif
+TO_PY_OBJECT(long long, PyLong_FromLongLong(value))
+TO_PY_OBJECT(unsigned long long, PyLong_FromUnsignedLongLong(value))
+TO_PY_OBJECT(float, PyFloat_FromDouble(value))
+TO_PY_OBJECT(double, PyFloat_FromDouble(value))
+TO_PY_OBJECT(bool, PyBool_FromLong(value))
+TO_PY_OBJECT(char, converter::do_return_to_python(value))
+TO_PY_OBJECT(const char *, converter::do_return_to_python(value))
+
+// Returns a new Pointer instance. Raises a Python exception and returns NULL
+// if the object couldn't be created.
+inline PyObject* ToPyPointer(unsigned long ulAddr)
+{
+    try
+    {
+        return incref(object(CPointer(ulAddr)).ptr());
+    }
+    catch (error_already_set&)
+    {
+        return NULL;
+    }
+}
+
+// Returns the wrapped C++ instance of a Python object or NULL. No Python error
+// is set if the object doesn't wrap a T instance.
+template<class T>
+inline T* GetPyInstance(PyObject* pObj)
+{
+    return (T *) converter::get_lvalue_from_python(pObj, converter::registered<T>::converters);
+}
+
+
+// ============================================================================
+// >> NativeType_t enum
+// ============================================================================
+// These are the types that are accessible through the get_<type> and
+// set_<type> methods. String arrays are excluded, because they have no fixed
+// size.
+enum NativeType_t
+{
+    NATIVE_BOOL,
+    NATIVE_CHAR,
+    NATIVE_UCHAR,
+    NATIVE_SHORT,
+    NATIVE_USHORT,
+    NATIVE_INT,
+    NATIVE_UINT,
+    NATIVE_LONG,
+    NATIVE_ULONG,
+    NATIVE_LONG_LONG,
+    NATIVE_ULONG_LONG,
+    NATIVE_FLOAT,
+    NATIVE_DOUBLE,
+    NATIVE_PTR,
+    NATIVE_STRING,
+    NATIVE_INVALID
+};
+
+// Calls function<T>(...) with the C++ type of a fixed size native type.
+// Strings are not handled.
+#define NATIVE_TYPE_DISPATCH(eType, function, ...) \
+    switch (eType) \
+    { \
+        case NATIVE_BOOL:       function<bool>(__VA_ARGS__); break; \
+        case NATIVE_CHAR:       function<char>(__VA_ARGS__); break; \
+        case NATIVE_UCHAR:      function<unsigned char>(__VA_ARGS__); break; \
+        case NATIVE_SHORT:      function<short>(__VA_ARGS__); break; \
+        case NATIVE_USHORT:     function<unsigned short>(__VA_ARGS__); break; \
+        case NATIVE_INT:        function<int>(__VA_ARGS__); break; \
+        case NATIVE_UINT:       function<unsigned int>(__VA_ARGS__); break; \
+        case NATIVE_LONG:       function<long>(__VA_ARGS__); break; \
+        case NATIVE_ULONG:      function<unsigned long>(__VA_ARGS__); break; \
+        case NATIVE_LONG_LONG:  function<long long>(__VA_ARGS__); break; \
+        case NATIVE_ULONG_LONG: function<unsigned long long>(__VA_ARGS__); break; \
+        case NATIVE_FLOAT:      function<float>(__VA_ARGS__); break; \
+        case NATIVE_DOUBLE:     function<double>(__VA_ARGS__); break; \
+        case NATIVE_PTR:        function<unsigned long>(__VA_ARGS__); break; \
+        default: BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported.") \
+    }
+
+// Returns NATIVE_INVALID if the name is unknown.
+NativeType_t GetNativeType(const char* szName);
+
+// Same like GetNativeType(), but raises a ValueError if the name is unknown.
+NativeType_t ExtractNativeType(const char* szName);
+
+int  GetNativeTypeSize(NativeType_t eType);
+
+// Returns the type code of the array module or 0 if there is none.
+char GetArrayTypeCode(NativeType_t eType);
+
+// Returns a new reference or NULL if an error occured.
+PyObject* ReadNativeValue(NativeType_t eType, unsigned long ulAddr);
+
+// Returns false and sets a Python error if the value couldn't be converted.
+bool WriteNativeValue(NativeType_t eType, unsigned long ulAddr, PyObject* pValue);
+
+#endif // _BINUTILS_CONVERT_H
@@ -0,0 +1,885 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string.h>
+
+#include "binutils_descriptors.h"
+#include "binutils_convert.h"
+#include "binutils_macros.h"
+#include "binutils_tools.h"
+
+#include "structmember.h"
+
+
+// ============================================================================
+// >> STRUCTURES
+// ============================================================================
+struct VTableEntry_t
+{
+    unsigned long m_ulVTable;
+    PyObject*     m_pFunction;
+};
+
+// Used by MemberFunction and VirtualMemberFunction
+struct MemberFunction_t
+{
+    PyObject_HEAD
+
+    // The Function object or an object that creates it via resolve(). NULL
+    // for virtual functions
+    PyObject*     m_pFunction;
+    char          m_bResolved;
+    PyObject*     m_pDoc;
+
+    // Only used by virtual functions
+    int           m_iIndex;
+    Convention_t  m_eConv;
+    PyObject*     m_pParams;
+    PyObject*     m_pConverter;
+    VTableEntry_t m_VTableCache[VTABLE_CACHE_SIZE];
+    int           m_iNextCacheEntry;
+};
+
+struct BoundFunction_t
+{
+    PyObject_HEAD
+    PyObject* m_pFunction;
+    PyObject* m_pThis;
+    PyObject* m_pDoc;
+    char      m_bVirtual;
+};
+
+struct Attribute_t
+{
+    PyObject_HEAD
+    PyObject*    m_pManager;
+    PyObject*    m_pType;
+    PyObject*    m_pDoc;
+
+    // Key of the converter in the manager. Only used for pointers
+    PyObject*    m_pConverterName;
+
+    // NATIVE_PTR for custom types
+    NativeType_t m_eType;
+    char         m_bStringArray;
+
+    int          m_iOffset;
+    int          m_iLength;
+    char         m_bIsArray;
+    char         m_bAligned;
+    int          m_iFlags;
+};
+
+static PyTypeObject MemberFunction_Type = { PyVarObject_HEAD_INIT(NULL, 0) "_binutils.MemberFunction" };
+static PyTypeObject VirtualMemberFunction_Type = { PyVarObject_HEAD_INIT(NULL, 0) "_binutils.VirtualMemberFunction" };
+static PyTypeObject BoundFunction_Type = { PyVarObject_HEAD_INIT(NULL, 0) "_binutils.BoundFunction" };
+static PyTypeObject Attribute_Type = { PyVarObject_HEAD_INIT(NULL, 0) "_binutils.Attribute" };
+
+
+// ============================================================================
+// >> HELPER FUNCTIONS
+// ============================================================================
+// Calls the function with <this> as the first argument. Pass NULL to call it
+// with the given arguments only.
+PyObject* CallFunction(PyObject* pFunction, PyObject* pThis, PyObject* args, PyObject* kwargs, bool bTrampoline)
+{
+    if (kwargs && PyDict_Size(kwargs))
+    {
+        PyErr_SetString(PyExc_TypeError, "Functions don't accept keyword arguments.");
+        return NULL;
+    }
+
+    CFunction* pFunc = GetPyInstance<CFunction>(pFunction);
+    if (!pFunc)
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected a Function object.");
+        return NULL;
+    }
+
+    PyObject* pArgs = args;
+    if (pThis)
+    {
+        Py_ssize_t iCount = PyTuple_GET_SIZE(args);
+        pArgs = PyTuple_New(iCount + 1);
+        if (!pArgs)
+            return NULL;
+
+        Py_INCREF(pThis);
+        PyTuple_SET_ITEM(pArgs, 0, pThis);
+        for (Py_ssize_t i=0; i < iCount; i++)
+        {
+            PyObject* pItem = PyTuple_GET_ITEM(args, i);
+            Py_INCREF(pItem);
+            PyTuple_SET_ITEM(pArgs, i + 1, pItem);
+        }
+    }
+    else
+        Py_INCREF(pArgs);
+
+    object oArgs = object(handle<>(pArgs));
+
+    BEGIN_CPYTHON_CALL()
+    object oResult = bTrampoline ? pFunc->CallTrampoline(oArgs) : pFunc->__call__(oArgs);
+    return incref(oResult.ptr());
+    END_CPYTHON_CALL(NULL)
+}
+
+// Returns a new reference to the Function object of the virtual function or
+// NULL if an error occured.
+PyObject* ResolveVirtualFunction(MemberFunction_t* self, PyObject* pThis)
+{
+    unsigned long ulThis;
+    if (!TryExtractPyPtr(pThis, ulThis))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected an address or a Pointer object.");
+        return NULL;
+    }
+
+    if (!ulThis)
+    {
+        PyErr_SetString(PyExc_ValueError, "Pointer is NULL.");
+        return NULL;
+    }
+
+    unsigned long ulVTable = *(unsigned long *) ulThis;
+    for (int i=0; i < VTABLE_CACHE_SIZE; i++)
+    {
+        VTableEntry_t& entry = self->m_VTableCache[i];
+        if (entry.m_pFunction && entry.m_ulVTable == ulVTable)
+        {
+            Py_INCREF(entry.m_pFunction);
+            return entry.m_pFunction;
+        }
+    }
+
+    BEGIN_CPYTHON_CALL()
+    CPointer func = CPointer(ulThis).GetVirtualFunc(self->m_iIndex);
+    PyObject* pConverter = self->m_pConverter == Py_None ? NULL : self->m_pConverter;
+    object oFunction = object(CFunction(func.m_ulAddr, self->m_eConv, extract<char *>(self->m_pParams), pConverter));
+
+    // Replace the oldest entry
+    VTableEntry_t& entry = self->m_VTableCache[self->m_iNextCacheEntry];
+    self->m_iNextCacheEntry = (self->m_iNextCacheEntry + 1) % VTABLE_CACHE_SIZE;
+
+    Py_XDECREF(entry.m_pFunction);
+    entry.m_ulVTable = ulVTable;
+    entry.m_pFunction = incref(oFunction.ptr());
+    return incref(oFunction.ptr());
+    END_CPYTHON_CALL(NULL)
+}
+
+PyObject* CreateBoundFunction(PyObject* pFunction, PyObject* pThis, PyObject* pDoc, bool bVirtual)
+{
+    BoundFunction_t* pBound = PyObject_GC_New(BoundFunction_t, &BoundFunction_Type);
+    if (!pBound)
+        return NULL;
+
+    Py_INCREF(pFunction);
+    Py_INCREF(pThis);
+    Py_XINCREF(pDoc);
+
+    pBound->m_pFunction = pFunction;
+    pBound->m_pThis = pThis;
+    pBound->m_pDoc = pDoc;
+    pBound->m_bVirtual = bVirtual;
+    PyObject_GC_Track(pBound);
+    return (PyObject *) pBound;
+}
+
+PyObject* GetBoundFunction(PyObject* pObj)
+{
+    if (Py_TYPE(pObj) != &BoundFunction_Type)
+        return NULL;
+
+    return ((BoundFunction_t *) pObj)->m_pFunction;
+}
+
+inline bool IsVirtual(MemberFunction_t* self)
+{
+    return Py_TYPE(self) == &VirtualMemberFunction_Type;
+}
+
+// Returns a borrowed reference to the Function object of a non-virtual member
+// function or NULL if an error occured. Lazy functions are resolved on the
+// first call and replaced with the result.
+PyObject* GetMemberFunction(MemberFunction_t* self)
+{
+    if (self->m_bResolved)
+        return self->m_pFunction;
+
+    PyObject* pFunction = PyObject_CallMethod(self->m_pFunction, "resolve", NULL);
+    if (!pFunction)
+        return NULL;
+
+    if (!GetPyInstance<CFunction>(pFunction))
+    {
+        Py_DECREF(pFunction);
+        PyErr_SetString(PyExc_TypeError, "resolve() must return a Function object.");
+        return NULL;
+    }
+
+    Py_DECREF(self->m_pFunction);
+    self->m_pFunction = pFunction;
+    self->m_bResolved = true;
+    return pFunction;
+}
+
+
+// ============================================================================
+// >> MemberFunction and VirtualMemberFunction
+// ============================================================================
+static int MemberFunction_Traverse(MemberFunction_t* self, visitproc visit, void* arg)
+{
+    Py_VISIT(self->m_pFunction);
+    Py_VISIT(self->m_pDoc);
+    Py_VISIT(self->m_pParams);
+    Py_VISIT(self->m_pConverter);
+    for (int i=0; i < VTABLE_CACHE_SIZE; i++)
+        Py_VISIT(self->m_VTableCache[i].m_pFunction);
+
+    return 0;
+}
+
+static int MemberFunction_Clear(MemberFunction_t* self)
+{
+    Py_CLEAR(self->m_pFunction);
+    Py_CLEAR(self->m_pDoc);
+    Py_CLEAR(self->m_pParams);
+    Py_CLEAR(self->m_pConverter);
+    for (int i=0; i < VTABLE_CACHE_SIZE; i++)
+        Py_CLEAR(self->m_VTableCache[i].m_pFunction);
+
+    return 0;
+}
+
+static void MemberFunction_Dealloc(MemberFunction_t* self)
+{
+    PyObject_GC_UnTrack(self);
+    MemberFunction_Clear(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int MemberFunction_Init(MemberFunction_t* self, PyObject* args, PyObject* kwargs)
+{
+    PyObject* pFunction;
+    PyObject* pDoc = Py_None;
+    static char* s_szKeywords[] = {"function", "doc", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", s_szKeywords, &pFunction, &pDoc))
+        return -1;
+
+    bool bResolved = GetPyInstance<CFunction>(pFunction) != NULL;
+    if (!bResolved && !PyObject_HasAttrString(pFunction, "resolve"))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected a Function object or an object with a resolve() method.");
+        return -1;
+    }
+
+    MemberFunction_Clear(self);
+    Py_INCREF(pFunction);
+    Py_INCREF(pDoc);
+    self->m_pFunction = pFunction;
+    self->m_bResolved = bResolved;
+    self->m_pDoc = pDoc;
+    return 0;
+}
+
+static int VirtualMemberFunction_Init(MemberFunction_t* self, PyObject* args, PyObject* kwargs)
+{
+    int iIndex;
+    PyObject* pConv;
+    PyObject* pParams;
+    PyObject* pConverter = Py_None;
+    PyObject* pDoc = Py_None;
+    static char* s_szKeywords[] = {"index", "convention", "parameters", "converter", "doc", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iOO|OO", s_szKeywords, &iIndex, &pConv, &pParams, &pConverter, &pDoc))
+        return -1;
+
+    if (!extract<char *>(pParams).check())
+    {
+        PyErr_SetString(PyExc_TypeError, "Parameters must be a string.");
+        return -1;
+    }
+
+    BEGIN_CPYTHON_CALL()
+    self->m_eConv = extract<Convention_t>(pConv);
+    END_CPYTHON_CALL(-1)
+
+    MemberFunction_Clear(self);
+    Py_INCREF(pParams);
+    Py_INCREF(pConverter);
+    Py_INCREF(pDoc);
+    self->m_iIndex = iIndex;
+    self->m_pParams = pParams;
+    self->m_pConverter = pConverter;
+    self->m_pDoc = pDoc;
+    self->m_iNextCacheEntry = 0;
+    return 0;
+}
+
+static PyObject* MemberFunction_DescrGet(MemberFunction_t* self, PyObject* obj, PyObject* type)
+{
+    // Accessed through the class
+    if (!obj || obj == Py_None)
+    {
+        Py_INCREF(self);
+        return (PyObject *) self;
+    }
+
+    if (!IsVirtual(self))
+    {
+        PyObject* pFunction = GetMemberFunction(self);
+        return pFunction ? CreateBoundFunction(pFunction, obj, self->m_pDoc, false) : NULL;
+    }
+
+    PyObject* pFunction = ResolveVirtualFunction(self, obj);
+    if (!pFunction)
+        return NULL;
+
+    PyObject* pBound = CreateBoundFunction(pFunction, obj, self->m_pDoc, true);
+    Py_DECREF(pFunction);
+    return pBound;
+}
+
+static PyObject* MemberFunction_Call(MemberFunction_t* self, PyObject* args, PyObject* kwargs)
+{
+    if (!IsVirtual(self))
+    {
+        PyObject* pFunction = GetMemberFunction(self);
+        return pFunction ? CallFunction(pFunction, NULL, args, kwargs, false) : NULL;
+    }
+
+    // We need the this-pointer to find the function
+    if (!PyTuple_GET_SIZE(args))
+    {
+        PyErr_SetString(PyExc_TypeError, "Virtual functions require a this-pointer.");
+        return NULL;
+    }
+
+    PyObject* pFunction = ResolveVirtualFunction(self, PyTuple_GET_ITEM(args, 0));
+    if (!pFunction)
+        return NULL;
+
+    PyObject* pResult = CallFunction(pFunction, NULL, args, kwargs, false);
+    Py_DECREF(pFunction);
+    return pResult;
+}
+
+// Redirects unknown attributes to the Function object. Virtual functions
+// don't have one until a this-pointer was passed.
+static PyObject* MemberFunction_GetAttr(MemberFunction_t* self, PyObject* pName)
+{
+    PyObject* pResult = PyObject_GenericGetAttr((PyObject *) self, pName);
+    if (pResult || !PyErr_ExceptionMatches(PyExc_AttributeError))
+        return pResult;
+
+    if (IsVirtual(self))
+    {
+        PyErr_SetString(PyExc_AttributeError, "This function is virtual. You need a pointer to access this attribute.");
+        return NULL;
+    }
+
+    PyErr_Clear();
+    return PyObject_GetAttr(self->m_pFunction, pName);
+}
+
+static PyObject* MemberFunction_IsVirtual(MemberFunction_t* self, void* closure)
+{
+    return PyBool_FromLong(IsVirtual(self));
+}
+
+static PyMemberDef MemberFunction_Members[] = {
+    {"__doc__",  T_OBJECT, offsetof(MemberFunction_t, m_pDoc),      0,        NULL},
+    {"function", T_OBJECT, offsetof(MemberFunction_t, m_pFunction), READONLY, "The wrapped Function object or the lazy function, if it hasn't been resolved yet."},
+    {NULL}
+};
+
+static PyMemberDef VirtualMemberFunction_Members[] = {
+    {"__doc__",    T_OBJECT, offsetof(MemberFunction_t, m_pDoc),       0,        NULL},
+    {"index",      T_INT,    offsetof(MemberFunction_t, m_iIndex),     READONLY, "Index of the function in the virtual table."},
+    {"parameters", T_OBJECT, offsetof(MemberFunction_t, m_pParams),    READONLY, "The parameter string."},
+    {"converter",  T_OBJECT, offsetof(MemberFunction_t, m_pConverter), READONLY, "The converter of the return value."},
+    {NULL}
+};
+
+static PyGetSetDef MemberFunction_GetSet[] = {
+    {"is_virtual", (getter) MemberFunction_IsVirtual, NULL, NULL, NULL},
+    {NULL}
+};
+
+
+// ============================================================================
+// >> BoundFunction
+// ============================================================================
+static int BoundFunction_Traverse(BoundFunction_t* self, visitproc visit, void* arg)
+{
+    Py_VISIT(self->m_pFunction);
+    Py_VISIT(self->m_pThis);
+    Py_VISIT(self->m_pDoc);
+    return 0;
+}
+
+static int BoundFunction_Clear(BoundFunction_t* self)
+{
+    Py_CLEAR(self->m_pFunction);
+    Py_CLEAR(self->m_pThis);
+    Py_CLEAR(self->m_pDoc);
+    return 0;
+}
+
+static void BoundFunction_Dealloc(BoundFunction_t* self)
+{
+    PyObject_GC_UnTrack(self);
+    BoundFunction_Clear(self);
+    PyObject_GC_Del(self);
+}
+
+static PyObject* BoundFunction_Call(BoundFunction_t* self, PyObject* args, PyObject* kwargs)
+{
+    return CallFunction(self->m_pFunction, self->m_pThis, args, kwargs, false);
+}
+
+static PyObject* BoundFunction_CallTrampoline(BoundFunction_t* self, PyObject* args, PyObject* kwargs)
+{
+    return CallFunction(self->m_pFunction, self->m_pThis, args, kwargs, true);
+}
+
+static PyObject* BoundFunction_GetAttr(BoundFunction_t* self, PyObject* pName)
+{
+    PyObject* pResult = PyObject_GenericGetAttr((PyObject *) self, pName);
+    if (pResult || !PyErr_ExceptionMatches(PyExc_AttributeError))
+        return pResult;
+
+    PyErr_Clear();
+    return PyObject_GetAttr(self->m_pFunction, pName);
+}
+
+
+// Bound functions are still accepted wherever the address of the function was
+// accepted before, e.g. int(instance.method). TryExtractPyPtr() also accepts
+// them.
+static PyObject* BoundFunction_Int(BoundFunction_t* self)
+{
+    return PyObject_CallMethod(self->m_pFunction, "__int__", NULL);
+}
+
+static PyObject* BoundFunction_GetAddress(BoundFunction_t* self, void* closure)
+{
+    return PyObject_GetAttrString(self->m_pFunction, "address");
+}
+
+static PyNumberMethods BoundFunction_NumberMethods;
+
+static PyMethodDef BoundFunction_Methods[] = {
+    {"call_trampoline", (PyCFunction) BoundFunction_CallTrampoline, METH_VARARGS | METH_KEYWORDS, "Calls the trampoline function dynamically."},
+    {NULL}
+};
+
+static PyMemberDef BoundFunction_Members[] = {
+    {"__doc__",    T_OBJECT, offsetof(BoundFunction_t, m_pDoc),      READONLY, NULL},
+    {"function",   T_OBJECT, offsetof(BoundFunction_t, m_pFunction), READONLY, "The Function object."},
+    {"this",       T_OBJECT, offsetof(BoundFunction_t, m_pThis),     READONLY, "The this-pointer."},
+    {"is_virtual", T_BOOL,   offsetof(BoundFunction_t, m_bVirtual),  READONLY, NULL},
+    {NULL}
+};
+
+static PyGetSetDef BoundFunction_GetSet[] = {
+    {"address", (getter) BoundFunction_GetAddress, NULL, "The address of the bound function.", NULL},
+    {NULL}
+};
+
+
+// ============================================================================
+// >> Attribute
+// ============================================================================
+// Returns the converter of the attribute. It's looked up on every access,
+// because the type might have been registered after the attribute was created.
+object GetConverter(Attribute_t* self)
+{
+    PyObject* pConverter = PyDict_GetItem(self->m_pManager, self->m_pConverterName);
+    if (!pConverter)
+    {
+        PyErr_SetObject(PyExc_KeyError, self->m_pConverterName);
+        throw_error_already_set();
+    }
+    return object(handle<>(borrowed(pConverter)));
+}
+
+object MakePyArray(NativeType_t eType, unsigned long ulAddr, int iLength)
+{
+    switch (eType)
+    {
+        case NATIVE_BOOL:       return object(CArray<bool>(ulAddr, iLength));
+        case NATIVE_CHAR:       return object(CArray<char>(ulAddr, iLength));
+        case NATIVE_UCHAR:      return object(CArray<unsigned char>(ulAddr, iLength));
+        case NATIVE_SHORT:      return object(CArray<short>(ulAddr, iLength));
+        case NATIVE_USHORT:     return object(CArray<unsigned short>(ulAddr, iLength));
+        case NATIVE_INT:        return object(CArray<int>(ulAddr, iLength));
+        case NATIVE_UINT:       return object(CArray<unsigned int>(ulAddr, iLength));
+        case NATIVE_LONG:       return object(CArray<long>(ulAddr, iLength));
+        case NATIVE_ULONG:      return object(CArray<unsigned long>(ulAddr, iLength));
+        case NATIVE_LONG_LONG:  return object(CArray<long long>(ulAddr, iLength));
+        case NATIVE_ULONG_LONG: return object(CArray<unsigned long long>(ulAddr, iLength));
+        case NATIVE_FLOAT:      return object(CArray<float>(ulAddr, iLength));
+        case NATIVE_DOUBLE:     return object(CArray<double>(ulAddr, iLength));
+        case NATIVE_STRING:     return object(CArray<const char *>(ulAddr, iLength));
+        default: break;
+    }
+    BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported.")
+    return object();
+}
+
+object GetArray(Attribute_t* self, unsigned long ulAddr)
+{
+    // Aligned arrays are stored inside the instance. Others are only referenced
+    unsigned long ulArray = ulAddr + self->m_iOffset;
+    if (!self->m_bAligned)
+        ulArray = *(unsigned long *) ulArray;
+
+    if (self->m_eType != NATIVE_PTR)
+        return MakePyArray(self->m_eType, ulArray, self->m_iLength);
+
+    object oConverter = GetConverter(self);
+    unsigned int iSize = extract<unsigned int>(oConverter.attr("size"));
+    return object(CPtrArray(ulArray, iSize, self->m_iLength, oConverter.ptr()));
+}
+
+object GetAttributeValue(Attribute_t* self, unsigned long ulAddr)
+{
+    if (self->m_bIsArray)
+        return GetArray(self, ulAddr);
+
+    unsigned long ulField = ulAddr + self->m_iOffset;
+    if (self->m_bStringArray)
+        return object(handle<>(ToPyObject<const char *>((const char *) ulField)));
+
+    // Aligned types are stored inside the instance
+    if (self->m_bAligned)
+        return GetConverter(self)(CPointer(ulField));
+
+    if (self->m_eType == NATIVE_PTR)
+        return GetConverter(self)(CPointer(*(unsigned long *) ulField));
+
+    PyObject* pValue = ReadNativeValue(self->m_eType, ulField);
+    if (!pValue)
+        throw_error_already_set();
+
+    return object(handle<>(pValue));
+}
+
+void SetArray(Attribute_t* self, unsigned long ulAddr, object oValue)
+{
+    object oArray = GetArray(self, ulAddr);
+    if (GetPyInstance<CPointer>(oValue.ptr()))
+    {
+        // Use the length of the given array if we don't know our length
+        int iLength = self->m_iLength;
+        if (iLength == -1)
+        {
+            iLength = extract<int>(oValue.attr("length"));
+            if (iLength == -1)
+                BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Setting arrays requires a length.")
+        }
+
+        for (int i=0; i < iLength; i++)
+            oArray[i] = oValue[i];
+
+        return;
+    }
+
+    object oIter = object(handle<>(PyObject_GetIter(oValue.ptr())));
+    int iIndex = 0;
+    while (PyObject* pItem = PyIter_Next(oIter.ptr()))
+        oArray[iIndex++] = object(handle<>(pItem));
+
+    if (PyErr_Occurred())
+        throw_error_already_set();
+}
+
+void SetAttributeValue(Attribute_t* self, unsigned long ulAddr, object oValue)
+{
+    if (self->m_bIsArray)
+        return SetArray(self, ulAddr, oValue);
+
+    if (self->m_bStringArray)
+        return CPointer(ulAddr).SetStringArray(extract<char *>(oValue), self->m_iOffset, self->m_iLength);
+
+    unsigned long ulField = ulAddr + self->m_iOffset;
+    if (self->m_bAligned)
+    {
+        unsigned long ulSize = extract<unsigned long>(GetConverter(self).attr("size"));
+        memmove((void *) ulField, (void *) ExtractPyPtr(oValue), ulSize);
+        return;
+    }
+
+    if (!WriteNativeValue(self->m_eType, ulField, oValue.ptr()))
+        throw_error_already_set();
+}
+
+// Returns the address of the instance or 0 if it's a NULL pointer. In that
+// case a Python exception has been set.
+inline unsigned long GetInstanceAddress(PyObject* obj)
+{
+    CPointer* pPtr = GetPyInstance<CPointer>(obj);
+    if (!pPtr)
+    {
+        PyErr_SetString(PyExc_TypeError, "Attributes can only be used by Pointer subclasses.");
+        return 0;
+    }
+
+    if (!pPtr->m_ulAddr)
+    {
+        PyErr_SetString(PyExc_ValueError, "Pointer is NULL.");
+        return 0;
+    }
+    return pPtr->m_ulAddr;
+}
+
+static int Attribute_Traverse(Attribute_t* self, visitproc visit, void* arg)
+{
+    Py_VISIT(self->m_pManager);
+    Py_VISIT(self->m_pType);
+    Py_VISIT(self->m_pDoc);
+    Py_VISIT(self->m_pConverterName);
+    return 0;
+}
+
+static int Attribute_Clear(Attribute_t* self)
+{
+    Py_CLEAR(self->m_pManager);
+    Py_CLEAR(self->m_pType);
+    Py_CLEAR(self->m_pDoc);
+    Py_CLEAR(self->m_pConverterName);
+    return 0;
+}
+
+static void Attribute_Dealloc(Attribute_t* self)
+{
+    PyObject_GC_UnTrack(self);
+    Attribute_Clear(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static int Attribute_Init(Attribute_t* self, PyObject* args, PyObject* kwargs)
+{
+    PyObject* pManager;
+    PyObject* pType;
+    int iOffset = 0;
+    int iLength = -1;
+    PyObject* pIsArray = Py_False;
+    PyObject* pAligned = Py_False;
+    int iFlags = ATTR_FLAG_READ | ATTR_FLAG_WRITE;
+    PyObject* pDoc = Py_None;
+    static char* s_szKeywords[] = {"manager", "type", "offset", "length", "is_array", "aligned", "flags", "doc", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iiOOiO", s_szKeywords, &pManager, &pType, &iOffset,
+            &iLength, &pIsArray, &pAligned, &iFlags, &pDoc))
+        return -1;
+
+    if (!PyDict_Check(pManager))
+    {
+        PyErr_SetString(PyExc_TypeError, "Manager must be a TypeManager instance.");
+        return -1;
+    }
+
+    extract<char *> szType(pType);
+    if (!szType.check())
+    {
+        PyErr_SetString(PyExc_TypeError, "Type must be a string.");
+        return -1;
+    }
+
+    PyObject* pConverterName = Py_None;
+    bool bStringArray = strcmp(szType(), "string_array") == 0;
+    NativeType_t eType = bStringArray ? NATIVE_STRING : GetNativeType(szType());
+
+    // Custom types are pointers that get converted by the manager
+    if (eType == NATIVE_INVALID)
+    {
+        eType = NATIVE_PTR;
+        pConverterName = pType;
+    }
+
+    Py_XDECREF(self->m_pManager);
+    Py_XDECREF(self->m_pType);
+    Py_XDECREF(self->m_pDoc);
+    Py_XDECREF(self->m_pConverterName);
+
+    Py_INCREF(pManager);
+    Py_INCREF(pType);
+    Py_INCREF(pDoc);
+    Py_INCREF(pConverterName);
+    self->m_pManager = pManager;
+    self->m_pType = pType;
+    self->m_pDoc = pDoc;
+    self->m_pConverterName = pConverterName;
+    self->m_eType = eType;
+    self->m_bStringArray = bStringArray;
+    self->m_iOffset = iOffset;
+    self->m_iLength = iLength;
+    self->m_bIsArray = PyObject_IsTrue(pIsArray) == 1;
+    self->m_bAligned = PyObject_IsTrue(pAligned) == 1;
+    self->m_iFlags = iFlags;
+    return 0;
+}
+
+static PyObject* Attribute_DescrGet(Attribute_t* self, PyObject* obj, PyObject* type)
+{
+    // Accessed through the class
+    if (!obj || obj == Py_None)
+    {
+        Py_INCREF(self);
+        return (PyObject *) self;
+    }
+
+    if (!(self->m_iFlags & ATTR_FLAG_READ))
+    {
+        PyErr_SetString(PyExc_AttributeError, "Attribute is not readable.");
+        return NULL;
+    }
+
+    unsigned long ulAddr = GetInstanceAddress(obj);
+    if (!ulAddr)
+        return NULL;
+
+    // Plain native types don't need any boost objects
+    if (!self->m_bIsArray && !self->m_bStringArray && !self->m_bAligned && self->m_eType != NATIVE_PTR)
+        return ReadNativeValue(self->m_eType, ulAddr + self->m_iOffset);
+
+    BEGIN_CPYTHON_CALL()
+    return incref(GetAttributeValue(self, ulAddr).ptr());
+    END_CPYTHON_CALL(NULL)
+}
+
+static int Attribute_DescrSet(Attribute_t* self, PyObject* obj, PyObject* value)
+{
+    if (!value)
+    {
+        PyErr_SetString(PyExc_AttributeError, "Attributes can't be deleted.");
+        return -1;
+    }
+
+    if (!(self->m_iFlags & ATTR_FLAG_WRITE))
+    {
+        PyErr_SetString(PyExc_AttributeError, "Attribute is not writeable.");
+        return -1;
+    }
+
+    unsigned long ulAddr = GetInstanceAddress(obj);
+    if (!ulAddr)
+        return -1;
+
+    if (!self->m_bIsArray && !self->m_bStringArray && !self->m_bAligned)
+        return WriteNativeValue(self->m_eType, ulAddr + self->m_iOffset, value) ? 0 : -1;
+
+    BEGIN_CPYTHON_CALL()
+    SetAttributeValue(self, ulAddr, object(handle<>(borrowed(value))));
+    return 0;
+    END_CPYTHON_CALL(-1)
+}
+
+static PyMemberDef Attribute_Members[] = {
+    {"__doc__",  T_OBJECT, offsetof(Attribute_t, m_pDoc),     0,        NULL},
+    {"type",     T_OBJECT, offsetof(Attribute_t, m_pType),    READONLY, "Name of the type."},
+    {"offset",   T_INT,    offsetof(Attribute_t, m_iOffset),  READONLY, "Offset of the attribute."},
+    {"length",   T_INT,    offsetof(Attribute_t, m_iLength),  READONLY, "Length of the array or the string."},
+    {"is_array", T_BOOL,   offsetof(Attribute_t, m_bIsArray), READONLY, NULL},
+    {"aligned",  T_BOOL,   offsetof(Attribute_t, m_bAligned), READONLY, NULL},
+    {"flags",    T_INT,    offsetof(Attribute_t, m_iFlags),   READONLY, "Read/write flags."},
+    {NULL}
+};
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+inline void AddType(PyTypeObject* pType)
+{
+    if (PyType_Ready(pType) != 0)
+        throw_error_already_set();
+
+    // Remove the module prefix
+    const char* szName = strrchr(pType->tp_name, '.') + 1;
+    scope().attr(szName) = object(handle<>(borrowed((PyObject *) pType)));
+}
+
+void ExposeDescriptors()
+{
+    MemberFunction_Type.tp_basicsize = sizeof(MemberFunction_t);
+    MemberFunction_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+    MemberFunction_Type.tp_doc = "Binds a Function object to the instance it's accessed through.";
+    MemberFunction_Type.tp_new = PyType_GenericNew;
+    MemberFunction_Type.tp_init = (initproc) MemberFunction_Init;
+    MemberFunction_Type.tp_dealloc = (destructor) MemberFunction_Dealloc;
+    MemberFunction_Type.tp_traverse = (traverseproc) MemberFunction_Traverse;
+    MemberFunction_Type.tp_clear = (inquiry) MemberFunction_Clear;
+    MemberFunction_Type.tp_descr_get = (descrgetfunc) MemberFunction_DescrGet;
+    MemberFunction_Type.tp_call = (ternaryfunc) MemberFunction_Call;
+    MemberFunction_Type.tp_getattro = (getattrofunc) MemberFunction_GetAttr;
+    MemberFunction_Type.tp_members = MemberFunction_Members;
+    MemberFunction_Type.tp_getset = MemberFunction_GetSet;
+    AddType(&MemberFunction_Type);
+
+    VirtualMemberFunction_Type.tp_basicsize = sizeof(MemberFunction_t);
+    VirtualMemberFunction_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+    VirtualMemberFunction_Type.tp_doc = "Finds a virtual function by the instance it's accessed through and binds it to the instance.";
+    VirtualMemberFunction_Type.tp_new = PyType_GenericNew;
+    VirtualMemberFunction_Type.tp_init = (initproc) VirtualMemberFunction_Init;
+    VirtualMemberFunction_Type.tp_dealloc = (destructor) MemberFunction_Dealloc;
+    VirtualMemberFunction_Type.tp_traverse = (traverseproc) MemberFunction_Traverse;
+    VirtualMemberFunction_Type.tp_clear = (inquiry) MemberFunction_Clear;
+    VirtualMemberFunction_Type.tp_descr_get = (descrgetfunc) MemberFunction_DescrGet;
+    VirtualMemberFunction_Type.tp_call = (ternaryfunc) MemberFunction_Call;
+    VirtualMemberFunction_Type.tp_getattro = (getattrofunc) MemberFunction_GetAttr;
+    VirtualMemberFunction_Type.tp_members = VirtualMemberFunction_Members;
+    VirtualMemberFunction_Type.tp_getset = MemberFunction_GetSet;
+    AddType(&VirtualMemberFunction_Type);
+
+    BoundFunction_Type.tp_basicsize = sizeof(BoundFunction_t);
+    BoundFunction_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+    BoundFunction_Type.tp_doc = "A function that passes the this-pointer automatically.";
+    BoundFunction_Type.tp_dealloc = (destructor) BoundFunction_Dealloc;
+    BoundFunction_Type.tp_traverse = (traverseproc) BoundFunction_Traverse;
+    BoundFunction_Type.tp_clear = (inquiry) BoundFunction_Clear;
+    BoundFunction_Type.tp_call = (ternaryfunc) BoundFunction_Call;
+    BoundFunction_Type.tp_getattro = (getattrofunc) BoundFunction_GetAttr;
+    BoundFunction_Type.tp_methods = BoundFunction_Methods;
+    BoundFunction_Type.tp_members = BoundFunction_Members;
+    BoundFunction_Type.tp_getset = BoundFunction_GetSet;
+    BoundFunction_NumberMethods.nb_int = (unaryfunc) BoundFunction_Int;
+#if PYTHON_VERSION != 3
+    BoundFunction_NumberMethods.nb_long = (unaryfunc) BoundFunction_Int;
+#endif
+    BoundFunction_Type.tp_as_number = &BoundFunction_NumberMethods;
+    AddType(&BoundFunction_Type);
+
+    Attribute_Type.tp_basicsize = sizeof(Attribute_t);
+    Attribute_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+    Attribute_Type.tp_doc = "Reads and writes an attribute of a custom type.";
+    Attribute_Type.tp_new = PyType_GenericNew;
+    Attribute_Type.tp_init = (initproc) Attribute_Init;
+    Attribute_Type.tp_dealloc = (destructor) Attribute_Dealloc;
+    Attribute_Type.tp_traverse = (traverseproc) Attribute_Traverse;
+    Attribute_Type.tp_clear = (inquiry) Attribute_Clear;
+    Attribute_Type.tp_descr_get = (descrgetfunc) Attribute_DescrGet;
+    Attribute_Type.tp_descr_set = (descrsetfunc) Attribute_DescrSet;
+    Attribute_Type.tp_members = Attribute_Members;
+    AddType(&Attribute_Type);
+}
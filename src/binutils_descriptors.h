@@ -0,0 +1,67 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_DESCRIPTORS_H
+#define _BINUTILS_DESCRIPTORS_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> DEFINITIONS
+// ============================================================================
+// Number of vtables a virtual member function remembers. Usually a function
+// is only called on a few different classes.
+#define VTABLE_CACHE_SIZE 4
+
+// Read/write flags of attributes. Must match AttrFlags in binutils/__init__.py
+#define ATTR_FLAG_READ  (1 << 0)
+#define ATTR_FLAG_WRITE (1 << 1)
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+/*
+    Adds the descriptor types to the current scope. They are plain CPython
+    types, because boost.python has no support for descriptors.
+
+    - MemberFunction(function, doc=None)
+    - VirtualMemberFunction(index, convention, parameters, converter=None, doc=None)
+
+    Accessing them through an instance returns a BoundFunction object, which
+    passes the instance as the this-pointer. <function> can also be an object
+    with a resolve() method, which returns the Function object on first use.
+
+    - Attribute(manager, type, offset=0, length=-1, is_array=False, aligned=False, flags=READ_WRITE, doc=None)
+
+    Reads and writes the attribute of the instance it's accessed through.
+    Types that are not native are converted by the manager.
+*/
+void ExposeDescriptors();
+
+// Returns a borrowed reference to the Function object of a BoundFunction or
+// NULL if <pObj> is not a BoundFunction.
+PyObject* GetBoundFunction(PyObject* pObj);
+
+#endif // _BINUTILS_DESCRIPTORS_H
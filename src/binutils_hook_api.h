@@ -0,0 +1,73 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_HOOK_API_H
+#define _BINUTILS_HOOK_API_H
+
+/*
+    C interface for native hook callbacks. This header has no dependencies,
+    so it can be included by C and C++ libraries that don't link against
+    binutils.
+
+    A native callback has the signature
+
+        bool callback(int hook_type, void* hook);
+
+    It can't call methods of the hook, because they live in the binutils
+    module. binutils.get_native_hook_api() returns the address of a
+    NativeHookApi_t, which the library has to store before its callbacks are
+    registered, e.g. by calling an init function with ctypes. The functions
+    use the default calling convention and can be called from any thread
+    while the hook is executed.
+*/
+
+// Incremented when functions are added. Functions are only appended.
+#define NATIVE_HOOK_API_VERSION 1
+
+typedef struct NativeHookApi_t
+{
+    int   m_iVersion;
+
+    // Returns the number of arguments (including the this-pointer)
+    int   (*GetArgumentCount)(void* pHook);
+
+    // Returns the type character of the argument or 0 if the index is out of
+    // range. Use -1 for the return type.
+    char  (*GetArgumentType)(void* pHook, int iIndex);
+
+    /*
+        Copies the argument into/from <pValue>. Arguments occupy at least 4
+        bytes, so <pValue> must have room for 4 bytes or 8 bytes for long
+        long and double arguments. Returns the number of copied bytes or 0 if
+        the index is out of range or the current thread isn't executing the
+        hook.
+    */
+    int   (*GetArgument)(void* pHook, int iIndex, void* pValue);
+    int   (*SetArgument)(void* pHook, int iIndex, const void* pValue);
+
+    // Same as above for the return value. Only valid in post-hooks unless
+    // it's set by a pre-hook that overrides the return value.
+    int   (*GetReturnValue)(void* pHook, void* pValue);
+    int   (*SetReturnValue)(void* pHook, const void* pValue);
+
+    // Returns the HookFrame_t of the current thread or NULL
+    void* (*GetHookFrame)(void* pHook);
+} NativeHookApi_t;
+
+#endif // _BINUTILS_HOOK_API_H
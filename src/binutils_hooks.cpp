@@ -20,6 +20,14 @@
 // ============================================================================
 // >> INCLUDES
 // ============================================================================
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "dynload.h"
+
 #include "binutils_hooks.h"
 #include "binutils_tools.h"
 #include "binutils_macros.h"
@@ -31,8 +39,29 @@ using namespace boost::python;
 // ============================================================================
 // >> GLOBAL VARIABLES
 // ============================================================================
-// g_mapCallbacks[<CHook *>][<HookType_t>] -> [<PyObject *>, <PyObject *>, ...]
-std::map<CHook *, std::map<DynamicHooks::HookType_t, std::list<PyObject *> > > g_mapCallbacks;
+// Number of hook handlers that are currently running. Replaced callback
+// arrays are only freed if no handler is running, because it might still
+// iterate over them. Handlers can run on any thread, so it's only changed
+// atomically.
+volatile long g_iRunningHandlers = 0;
+
+// Callback arrays that are waiting to be freed. Only used with the GIL.
+std::vector<CallbackArray_t *> g_vecRetiredArrays;
+
+// Size of g_vecRetiredArrays, so handlers can check it without the GIL
+volatile long g_iRetiredArrays = 0;
+
+// Python objects that own registered native callbacks (e.g. ctypes function
+// pointers) and the number of hooks they are registered at
+struct NativeCallbackOwner_t
+{
+    NativeCallbackOwner_t() : m_iRefs(0) {}
+
+    object m_oOwner;
+    int    m_iRefs;
+};
+
+std::map<HookFn, NativeCallbackOwner_t> g_mapNativeOwners;
 
 
 // ============================================================================
@@ -65,17 +94,423 @@ object GetArgument(CHook* pHook, int iIndex)
 }
 
 
+// ============================================================================
+// >> CHookPredicate
+// ============================================================================
+CHookPredicate::CHookPredicate()
+{
+    m_bLocked = false;
+}
+
+void CHookPredicate::Arg(int iIndex, const char* szOp, object oOperand, object oMask)
+{
+    PredicateTerm_t term;
+    term.m_iIndex  = iIndex;
+    term.m_bDeref  = false;
+    term.m_iOffset = 0;
+    term.m_iSize   = 0;
+    term.m_bSigned = false;
+    AddTerm(term, szOp, oOperand, oMask);
+}
+
+void CHookPredicate::Field(int iIndex, int iOffset, const char* szOp, object oOperand,
+    int iSize /* = 4 */, bool bSigned /* = false */, object oMask /* = object() */)
+{
+    if (iSize != 1 && iSize != 2 && iSize != 4 && iSize != 8)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Size must be 1, 2, 4 or 8.")
+
+    PredicateTerm_t term;
+    term.m_iIndex  = iIndex;
+    term.m_bDeref  = true;
+    term.m_iOffset = iOffset;
+    term.m_iSize   = iSize;
+    term.m_bSigned = bSigned;
+    AddTerm(term, szOp, oOperand, oMask);
+}
+
+long long ExtractOperand(object oOperand)
+{
+    unsigned long ulAddr;
+    if (TryExtractPyPtr(oOperand.ptr(), ulAddr))
+        return (long long) ulAddr;
+
+    return extract<long long>(oOperand);
+}
+
+void CHookPredicate::AddTerm(PredicateTerm_t& term, const char* szOp, object oOperand, object oMask)
+{
+    if (m_bLocked)
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "Predicate has already been registered.")
+
+    if (term.m_iIndex < 0)
+        BOOST_RAISE_EXCEPTION(PyExc_IndexError, "Argument index is out of range.")
+
+    if      (strcmp(szOp, "==") == 0) term.m_eOp = PREDICATE_EQ;
+    else if (strcmp(szOp, "!=") == 0) term.m_eOp = PREDICATE_NE;
+    else if (strcmp(szOp, "<") == 0)  term.m_eOp = PREDICATE_LT;
+    else if (strcmp(szOp, "<=") == 0) term.m_eOp = PREDICATE_LE;
+    else if (strcmp(szOp, ">") == 0)  term.m_eOp = PREDICATE_GT;
+    else if (strcmp(szOp, ">=") == 0) term.m_eOp = PREDICATE_GE;
+    else if (strcmp(szOp, "&") == 0)  term.m_eOp = PREDICATE_AND;
+    else if (strcmp(szOp, "in") == 0) term.m_eOp = PREDICATE_IN;
+    else
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Unknown operator.")
+
+    term.m_llOperand = 0;
+    if (term.m_eOp == PREDICATE_IN)
+    {
+        int iLength = len(oOperand);
+        for (int i=0; i < iLength; i++)
+            term.m_vecOperands.push_back(ExtractOperand(oOperand[i]));
+
+        std::sort(term.m_vecOperands.begin(), term.m_vecOperands.end());
+    }
+    else
+        term.m_llOperand = ExtractOperand(oOperand);
+
+    term.m_ullMask = oMask.is_none() ? (unsigned long long) -1 : extract<unsigned long long>(oMask);
+    m_vecTerms.push_back(term);
+}
+
+// Returns the type of the argument at the given index or 0 if the index is
+// out of range
+char GetParamType(const char* szParams, int iIndex)
+{
+    for (const char* ptr = szParams; *ptr && *ptr != ')'; ptr++)
+    {
+        if (*ptr != SIGCHAR_VOID && iIndex-- == 0)
+            return *ptr;
+    }
+    return 0;
+}
+
+// Returns the width and signedness of an integer, pointer or string argument
+void GetValueType(char cParam, int& iSize, bool& bSigned)
+{
+    switch(cParam)
+    {
+        case SIGCHAR_BOOL:      iSize = sizeof(bool);               bSigned = false; break;
+        case SIGCHAR_CHAR:      iSize = sizeof(char);               bSigned = true;  break;
+        case SIGCHAR_UCHAR:     iSize = sizeof(unsigned char);      bSigned = false; break;
+        case SIGCHAR_SHORT:     iSize = sizeof(short);              bSigned = true;  break;
+        case SIGCHAR_USHORT:    iSize = sizeof(unsigned short);     bSigned = false; break;
+        case SIGCHAR_INT:       iSize = sizeof(int);                bSigned = true;  break;
+        case SIGCHAR_UINT:      iSize = sizeof(unsigned int);       bSigned = false; break;
+        case SIGCHAR_LONG:      iSize = sizeof(long);               bSigned = true;  break;
+        case SIGCHAR_ULONG:     iSize = sizeof(unsigned long);      bSigned = false; break;
+        case SIGCHAR_LONGLONG:  iSize = sizeof(long long);          bSigned = true;  break;
+        case SIGCHAR_ULONGLONG: iSize = sizeof(unsigned long long); bSigned = false; break;
+        default:                iSize = sizeof(void *);             bSigned = false;
+    }
+}
+
+// Truncates the value to <iSize> bytes and sign- or zero-extends it again
+long long AdjustValue(long long llValue, int iSize, bool bSigned)
+{
+    switch(iSize)
+    {
+        case 1: return bSigned ? (long long) (char) llValue : (long long) (unsigned char) llValue;
+        case 2: return bSigned ? (long long) (short) llValue : (long long) (unsigned short) llValue;
+        case 4: return bSigned ? (long long) (int) llValue : (long long) (unsigned int) llValue;
+    }
+    return llValue;
+}
+
+void CHookPredicate::Validate(const char* szParams)
+{
+    // Check all terms first, so a failed validation doesn't leave the
+    // operands half adjusted
+    std::vector<PredicateTerm_t> vecTerms = m_vecTerms;
+    for (size_t i=0; i < vecTerms.size(); i++)
+    {
+        PredicateTerm_t& term = vecTerms[i];
+        char cParam = GetParamType(szParams, term.m_iIndex);
+        switch(cParam)
+        {
+            case 0:
+                BOOST_RAISE_EXCEPTION(PyExc_IndexError, "Argument index is out of range.")
+
+            case SIGCHAR_FLOAT:
+            case SIGCHAR_DOUBLE:
+                BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Predicates only support integer and pointer arguments.")
+
+            case SIGCHAR_STRING:
+                if (!term.m_bDeref)
+                    BOOST_RAISE_EXCEPTION(PyExc_TypeError, "String arguments can only be used with field().")
+                break;
+        }
+
+        // Fields already know their type
+        if (term.m_bDeref)
+            continue;
+
+        int iSize;
+        bool bSigned;
+        GetValueType(cParam, iSize, bSigned);
+
+        // The operands have been adjusted when the predicate was registered
+        // the first time
+        if (m_bLocked)
+        {
+            if (term.m_iSize != iSize || term.m_bSigned != bSigned)
+                BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Predicate has already been registered for arguments of a different type.")
+
+            continue;
+        }
+
+        term.m_iSize = iSize;
+        term.m_bSigned = bSigned;
+    }
+
+    if (m_bLocked)
+        return;
+
+    for (size_t i=0; i < vecTerms.size(); i++)
+    {
+        PredicateTerm_t& term = vecTerms[i];
+        // Values are masked before they are compared, so the operands are
+        // masked as well
+        term.m_llOperand = AdjustValue(term.m_llOperand & term.m_ullMask, term.m_iSize, term.m_bSigned);
+        for (size_t j=0; j < term.m_vecOperands.size(); j++)
+            term.m_vecOperands[j] = AdjustValue(term.m_vecOperands[j] & term.m_ullMask, term.m_iSize, term.m_bSigned);
+
+        std::sort(term.m_vecOperands.begin(), term.m_vecOperands.end());
+    }
+
+    m_vecTerms = vecTerms;
+    m_bLocked = true;
+}
+
+long long ReadArgumentValue(CHook* pHook, int iIndex)
+{
+    switch(pHook->GetArgument(iIndex)->m_cParam)
+    {
+        case SIGCHAR_BOOL:      return pHook->GetArgument<bool>(iIndex);
+        case SIGCHAR_CHAR:      return pHook->GetArgument<char>(iIndex);
+        case SIGCHAR_UCHAR:     return pHook->GetArgument<unsigned char>(iIndex);
+        case SIGCHAR_SHORT:     return pHook->GetArgument<short>(iIndex);
+        case SIGCHAR_USHORT:    return pHook->GetArgument<unsigned short>(iIndex);
+        case SIGCHAR_INT:       return pHook->GetArgument<int>(iIndex);
+        case SIGCHAR_UINT:      return pHook->GetArgument<unsigned int>(iIndex);
+        case SIGCHAR_LONG:      return pHook->GetArgument<long>(iIndex);
+        case SIGCHAR_ULONG:     return pHook->GetArgument<unsigned long>(iIndex);
+        case SIGCHAR_LONGLONG:  return pHook->GetArgument<long long>(iIndex);
+        case SIGCHAR_ULONGLONG: return (long long) pHook->GetArgument<unsigned long long>(iIndex);
+    }
+
+    // Pointers and strings
+    return pHook->GetArgument<unsigned long>(iIndex);
+}
+
+long long ReadFieldValue(unsigned long ulAddr, int iSize, bool bSigned)
+{
+    switch(iSize)
+    {
+        case 1: return bSigned ? (long long) *(char *) ulAddr : (long long) *(unsigned char *) ulAddr;
+        case 2: return bSigned ? (long long) *(short *) ulAddr : (long long) *(unsigned short *) ulAddr;
+        case 4: return bSigned ? (long long) *(int *) ulAddr : (long long) *(unsigned int *) ulAddr;
+    }
+    return *(long long *) ulAddr;
+}
+
+bool CHookPredicate::Evaluate(CHook* pHook)
+{
+    for (size_t i=0; i < m_vecTerms.size(); i++)
+    {
+        PredicateTerm_t& term = m_vecTerms[i];
+
+        long long llValue;
+        if (term.m_bDeref)
+        {
+            unsigned long ulAddr = pHook->GetArgument<unsigned long>(term.m_iIndex);
+            if (!ulAddr)
+                return false;
+
+            llValue = ReadFieldValue(ulAddr + term.m_iOffset, term.m_iSize, term.m_bSigned);
+        }
+        else
+            llValue = ReadArgumentValue(pHook, term.m_iIndex);
+
+        // Masking clears the sign extension, so the value is brought back to
+        // the type of the argument afterwards
+        if (term.m_ullMask != (unsigned long long) -1)
+            llValue = AdjustValue(llValue & term.m_ullMask, term.m_iSize, term.m_bSigned);
+
+        bool bMatch = false;
+        switch(term.m_eOp)
+        {
+            case PREDICATE_EQ:  bMatch = llValue == term.m_llOperand; break;
+            case PREDICATE_NE:  bMatch = llValue != term.m_llOperand; break;
+            case PREDICATE_LT:  bMatch = llValue <  term.m_llOperand; break;
+            case PREDICATE_LE:  bMatch = llValue <= term.m_llOperand; break;
+            case PREDICATE_GT:  bMatch = llValue >  term.m_llOperand; break;
+            case PREDICATE_GE:  bMatch = llValue >= term.m_llOperand; break;
+            case PREDICATE_AND: bMatch = (llValue & term.m_llOperand) != 0; break;
+            case PREDICATE_IN:
+                bMatch = std::binary_search(term.m_vecOperands.begin(), term.m_vecOperands.end(), llValue);
+                break;
+        }
+
+        if (!bMatch)
+            return false;
+    }
+    return true;
+}
+
+
+// ============================================================================
+// >> Callback arrays
+// ============================================================================
+CallbackArray_t* CreateCallbackArray(int iCount)
+{
+    CallbackArray_t* pArray = (CallbackArray_t *) malloc(sizeof(CallbackArray_t) + (iCount - 1) * sizeof(HookCallback_t));
+    pArray->m_iCount = iCount;
+    return pArray;
+}
+
+void FreeCallbackArray(CallbackArray_t* pArray)
+{
+    for (int i=0; i < pArray->m_iCount; i++)
+    {
+        Py_DECREF(pArray->m_Callbacks[i].m_pCallable);
+        Py_XDECREF(pArray->m_Callbacks[i].m_pPredicateObj);
+    }
+
+    free(pArray);
+}
+
+void CopyHookCallback(HookCallback_t& dest, const HookCallback_t& src)
+{
+    dest = src;
+    Py_INCREF(dest.m_pCallable);
+    Py_XINCREF(dest.m_pPredicateObj);
+}
+
+void FreeRetiredArrays()
+{
+    if (g_iRunningHandlers)
+        return;
+
+    for (size_t i=0; i < g_vecRetiredArrays.size(); i++)
+        FreeCallbackArray(g_vecRetiredArrays[i]);
+
+    g_vecRetiredArrays.clear();
+    g_iRetiredArrays = 0;
+}
+
+// Publishes the new array and retires the old one
+void PublishCallbackArray(HookCallbacks_t* pCallbacks, HookType_t eHookType, CallbackArray_t* pArray)
+{
+    // A full barrier is required, so g_iRunningHandlers is read after the
+    // new array has been published
+#ifdef __GNUC__
+    CallbackArray_t* pOld = (CallbackArray_t *) __sync_lock_test_and_set(&pCallbacks->m_pArrays[eHookType], pArray);
+    __sync_synchronize();
+#else
+    CallbackArray_t* pOld = (CallbackArray_t *) _InterlockedExchange((volatile long *) &pCallbacks->m_pArrays[eHookType], (long) pArray);
+#endif
+
+    if (pOld)
+    {
+        g_vecRetiredArrays.push_back(pOld);
+        g_iRetiredArrays = (long) g_vecRetiredArrays.size();
+    }
+
+    FreeRetiredArrays();
+}
+
+HookCallbacks_t* GetHookCallbacks(CHook* pHook)
+{
+    HookCallbacks_t* pCallbacks = (HookCallbacks_t *) pHook->m_pUserData;
+    if (!pCallbacks)
+    {
+        pCallbacks = new HookCallbacks_t;
+        pCallbacks->m_pArrays[HOOKTYPE_PRE] = NULL;
+        pCallbacks->m_pArrays[HOOKTYPE_POST] = NULL;
+        pHook->m_pUserData = pCallbacks;
+    }
+    return pCallbacks;
+}
+
+void AddHookCallback(CHook* pHook, HookType_t eHookType, PyObject* pCallable, object oPredicate)
+{
+    HookCallback_t callback = {pCallable, NULL, NULL};
+    if (!oPredicate.is_none())
+    {
+        CHookPredicate* pPredicate = extract<CHookPredicate*>(oPredicate);
+        callback.m_pPredicate = pPredicate;
+        callback.m_pPredicateObj = oPredicate.ptr();
+    }
+
+    HookCallbacks_t* pCallbacks = GetHookCallbacks(pHook);
+    CallbackArray_t* pOld = pCallbacks->m_pArrays[eHookType];
+    int iOldCount = pOld ? pOld->m_iCount : 0;
+
+    CallbackArray_t* pArray = CreateCallbackArray(iOldCount + 1);
+    for (int i=0; i < iOldCount; i++)
+        CopyHookCallback(pArray->m_Callbacks[i], pOld->m_Callbacks[i]);
+
+    CopyHookCallback(pArray->m_Callbacks[iOldCount], callback);
+    PublishCallbackArray(pCallbacks, eHookType, pArray);
+}
+
+int RemoveHookCallback(CHook* pHook, HookType_t eHookType, PyObject* pCallable)
+{
+    HookCallbacks_t* pCallbacks = (HookCallbacks_t *) pHook->m_pUserData;
+    CallbackArray_t* pOld = pCallbacks ? pCallbacks->m_pArrays[eHookType] : NULL;
+    if (!pOld)
+        return 0;
+
+    int iCount = 0;
+    for (int i=0; i < pOld->m_iCount; i++)
+    {
+        if (pOld->m_Callbacks[i].m_pCallable != pCallable)
+            iCount++;
+    }
+
+    if (iCount == pOld->m_iCount)
+        return iCount;
+
+    CallbackArray_t* pArray = NULL;
+    if (iCount)
+    {
+        pArray = CreateCallbackArray(iCount);
+        for (int i=0, j=0; i < pOld->m_iCount; i++)
+        {
+            if (pOld->m_Callbacks[i].m_pCallable == pCallable)
+                continue;
+
+            CopyHookCallback(pArray->m_Callbacks[j++], pOld->m_Callbacks[i]);
+        }
+    }
+    PublishCallbackArray(pCallbacks, eHookType, pArray);
+    return iCount;
+}
+
+
 // ============================================================================
 // >> Hook handler
 // ============================================================================
-bool binutils_HookHandler(DynamicHooks::HookType_t eHookType, CHook* pHook)
+inline bool IsCallbackMatching(HookCallback_t& callback, CHook* pHook)
 {
-    std::list<PyObject *> callbacks = g_mapCallbacks[pHook][eHookType];
+    return !callback.m_pPredicate || callback.m_pPredicate->Evaluate(pHook);
+}
 
-    // No need to do all this stuff, if there is no callback registered
-    if (callbacks.empty())
+bool CallHookCallbacks(DynamicHooks::HookType_t eHookType, CHook* pHook, CallbackArray_t* pArray)
+{
+    // Check the predicates before anything is converted to Python objects,
+    // so we don't enter Python at all if no callback matches
+    int iFirst = 0;
+    while (iFirst < pArray->m_iCount && !IsCallbackMatching(pArray->m_Callbacks[iFirst], pHook))
+        iFirst++;
+
+    if (iFirst == pArray->m_iCount)
         return false;
 
+    // The hooked function might have been called without the GIL (e.g. by a
+    // Function with release_gil=True or by another thread)
+    CGILGuard guard;
+
     object retval;
     if (eHookType == HOOKTYPE_POST)
     {
@@ -103,14 +538,19 @@ bool binutils_HookHandler(DynamicHooks::HookType_t eHookType, CHook* pHook)
     
     CStackData stackdata = CStackData(pHook);
     bool bOverride = false;
-    for (std::list<PyObject *>::iterator it=callbacks.begin(); it != callbacks.end(); it++)
+    for (int i=iFirst; i < pArray->m_iCount; i++)
     {
+        // Previous callbacks might have changed the arguments
+        if (i != iFirst && !IsCallbackMatching(pArray->m_Callbacks[i], pHook))
+            continue;
+
+        PyObject* pCallback = pArray->m_Callbacks[i].m_pCallable;
         BEGIN_BOOST_PY()
             object pyretval;
             if (eHookType == HOOKTYPE_PRE)
-                pyretval = CALL_PY_FUNC(*it, stackdata);
+                pyretval = CALL_PY_FUNC(pCallback, stackdata);
             else
-                pyretval = CALL_PY_FUNC(*it, stackdata, retval);
+                pyretval = CALL_PY_FUNC(pCallback, stackdata, retval);
 
             if (!pyretval.is_none())
             {
@@ -145,6 +585,252 @@ bool binutils_HookHandler(DynamicHooks::HookType_t eHookType, CHook* pHook)
     return bOverride;
 }
 
+bool binutils_HookHandler(DynamicHooks::HookType_t eHookType, CHook* pHook)
+{
+    HookCallbacks_t* pCallbacks = (HookCallbacks_t *) pHook->m_pUserData;
+    if (!pCallbacks)
+        return false;
+
+    // Make sure the array isn't freed while we are iterating over it. The
+    // counter must be increased before the array is read.
+    ATOMIC_INCREMENT(g_iRunningHandlers);
+    CallbackArray_t* pArray = pCallbacks->m_pArrays[eHookType];
+
+    // No need to do all this stuff, if there is no callback registered
+    bool bOverride = pArray && CallHookCallbacks(eHookType, pHook, pArray);
+
+    // The last running handler frees the retired arrays
+    if (ATOMIC_DECREMENT(g_iRunningHandlers) == 0 && g_iRetiredArrays)
+    {
+        CGILGuard guard;
+        FreeRetiredArrays();
+    }
+    return bOverride;
+}
+
+
+// ============================================================================
+// >> Native callbacks
+// ============================================================================
+void AddNativeHookCallback(CHook* pHook, HookType_t eHookType, HookFn pCallback)
+{
+    pHook->AddCallback(eHookType, (void *) pCallback);
+}
+
+void RemoveNativeHookCallback(CHook* pHook, HookType_t eHookType, HookFn pCallback)
+{
+    pHook->RemoveCallback(eHookType, (void *) pCallback);
+}
+
+/*
+    Returns the address of the given native callback. <oOwner> is set to the
+    object that has to be kept alive while the callback is registered and
+    <pLib> to the library that was loaded to find the callback.
+*/
+HookFn ExtractNativeCallback(object oCallback, object& oOwner, DLLib*& pLib)
+{
+    unsigned long ulAddr = 0;
+    pLib = NULL;
+    if (TryExtractPyPtr(oCallback.ptr(), ulAddr))
+    {
+        // Nothing to do
+    }
+    else if (PyTuple_Check(oCallback.ptr()) && len(oCallback) == 2)
+    {
+        const char* szPath   = extract<const char*>(oCallback[0]);
+        const char* szSymbol = extract<const char*>(oCallback[1]);
+
+        pLib = dlLoadLibrary(szPath);
+        if (!pLib)
+            BOOST_RAISE_EXCEPTION(PyExc_IOError, "Unable to load the library.")
+
+        ulAddr = (unsigned long) dlFindSymbol(pLib, szSymbol);
+        if (!ulAddr)
+        {
+            dlFreeLibrary(pLib);
+            BOOST_RAISE_EXCEPTION(PyExc_NameError, "Unable to find the symbol.")
+        }
+    }
+    else
+    {
+        // ctypes function pointers store the address in their buffer
+        object ctypes = import("ctypes");
+        if (!PyObject_IsInstance(oCallback.ptr(), object(ctypes.attr("_CFuncPtr")).ptr()))
+            BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Expected an address, a Pointer object, a ctypes function pointer or a (library, symbol) tuple.")
+
+        unsigned long ulBuffer = extract<unsigned long>(ctypes.attr("addressof")(oCallback));
+        ulAddr = *(unsigned long *) ulBuffer;
+        oOwner = oCallback;
+    }
+
+    if (!ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Callback is NULL.")
+
+    return (HookFn) ulAddr;
+}
+
+void AddNativeHookCallback(CHook* pHook, HookType_t eHookType, object oCallback)
+{
+    object oOwner;
+    DLLib* pLib;
+    HookFn pCallback = ExtractNativeCallback(oCallback, oOwner, pLib);
+    if (pHook->IsCallbackRegistered(eHookType, (void *) pCallback))
+        return;
+
+    AddNativeHookCallback(pHook, eHookType, pCallback);
+    if (oOwner.is_none())
+        return;
+
+    NativeCallbackOwner_t& owner = g_mapNativeOwners[pCallback];
+    owner.m_oOwner = oOwner;
+    owner.m_iRefs++;
+}
+
+void RemoveNativeHookCallback(CHook* pHook, HookType_t eHookType, object oCallback)
+{
+    object oOwner;
+    DLLib* pLib;
+    HookFn pCallback = ExtractNativeCallback(oCallback, oOwner, pLib);
+
+    // The library is still loaded, because it was loaded when the callback
+    // has been added
+    if (pLib)
+        dlFreeLibrary(pLib);
+
+    if (!pHook->IsCallbackRegistered(eHookType, (void *) pCallback))
+        return;
+
+    RemoveNativeHookCallback(pHook, eHookType, pCallback);
+
+    std::map<HookFn, NativeCallbackOwner_t>::iterator it = g_mapNativeOwners.find(pCallback);
+    if (it != g_mapNativeOwners.end() && --it->second.m_iRefs == 0)
+        g_mapNativeOwners.erase(it);
+}
+
+
+// ============================================================================
+// >> Native hook API
+// ============================================================================
+// Returns the address of the argument in the current frame or NULL
+void* GetArgumentStorage(CHook* pHook, HookFrame_t* pFrame, int iIndex)
+{
+    if (!pFrame || !pHook->GetArgument(iIndex))
+        return NULL;
+
+#ifdef _WIN32
+    if (pHook->m_eConvention == CONV_THISCALL && iIndex == 0)
+        return &pFrame->m_pECX;
+#endif
+
+    return (void *) ((unsigned long) pFrame->m_pESP + pHook->m_pParams[iIndex].m_iOffset + 4);
+}
+
+int NativeHookApi_GetArgumentCount(void* pHook)
+{
+    return ((CHook *) pHook)->GetArgumentCount();
+}
+
+char NativeHookApi_GetArgumentType(void* pHook, int iIndex)
+{
+    if (iIndex == -1)
+        return ((CHook *) pHook)->m_pRetParam->m_cParam;
+
+    Param_t* pParam = ((CHook *) pHook)->GetArgument(iIndex);
+    return pParam ? pParam->m_cParam : 0;
+}
+
+int NativeHookApi_GetArgument(void* pHook, int iIndex, void* pValue)
+{
+    CHook* pHookObj = (CHook *) pHook;
+    void* pStorage = GetArgumentStorage(pHookObj, pHookObj->GetHookFrame(), iIndex);
+    if (!pStorage)
+        return 0;
+
+    memcpy(pValue, pStorage, pHookObj->m_pParams[iIndex].m_iSize);
+    return pHookObj->m_pParams[iIndex].m_iSize;
+}
+
+int NativeHookApi_SetArgument(void* pHook, int iIndex, const void* pValue)
+{
+    CHook* pHookObj = (CHook *) pHook;
+    void* pStorage = GetArgumentStorage(pHookObj, pHookObj->GetHookFrame(), iIndex);
+    if (!pStorage)
+        return 0;
+
+    memcpy(pStorage, pValue, pHookObj->m_pParams[iIndex].m_iSize);
+    return pHookObj->m_pParams[iIndex].m_iSize;
+}
+
+int NativeHookApi_GetReturnValue(void* pHook, void* pValue)
+{
+    CHook* pHookObj = (CHook *) pHook;
+    HookFrame_t* pFrame = pHookObj->GetHookFrame();
+    if (!pFrame)
+        return 0;
+
+    memcpy(pValue, pFrame->m_pRetReg, pHookObj->m_pRetParam->m_iSize);
+    return pHookObj->m_pRetParam->m_iSize;
+}
+
+int NativeHookApi_SetReturnValue(void* pHook, const void* pValue)
+{
+    CHook* pHookObj = (CHook *) pHook;
+    HookFrame_t* pFrame = pHookObj->GetHookFrame();
+    if (!pFrame)
+        return 0;
+
+    memcpy(pFrame->m_pRetReg, pValue, pHookObj->m_pRetParam->m_iSize);
+    return pHookObj->m_pRetParam->m_iSize;
+}
+
+void* NativeHookApi_GetHookFrame(void* pHook)
+{
+    return ((CHook *) pHook)->GetHookFrame();
+}
+
+NativeHookApi_t g_NativeHookApi = {
+    NATIVE_HOOK_API_VERSION,
+    &NativeHookApi_GetArgumentCount,
+    &NativeHookApi_GetArgumentType,
+    &NativeHookApi_GetArgument,
+    &NativeHookApi_SetArgument,
+    &NativeHookApi_GetReturnValue,
+    &NativeHookApi_SetReturnValue,
+    &NativeHookApi_GetHookFrame
+};
+
+CPointer GetNativeHookApi()
+{
+    return CPointer((unsigned long) &g_NativeHookApi);
+}
+
+
+// ============================================================================
+// >> Hook enumeration
+// ============================================================================
+int GetHookCount()
+{
+    return GetHookManager()->GetHookCount();
+}
+
+list GetHooks()
+{
+    CHookManager* pManager = GetHookManager();
+
+    list hooks;
+    for (int i=0; i < pManager->GetHookCount(); i++)
+    {
+        CHook* pHook = pManager->GetHook(i);
+        hooks.append(make_tuple(
+            CPointer((unsigned long) pHook->m_pFunc),
+            CPointer((unsigned long) pHook->m_pTrampoline),
+            pHook->m_eConvention,
+            (const char *) pHook->m_szParams
+        ));
+    }
+    return hooks;
+}
+
 
 // ============================================================================
 // >> CStackData
@@ -159,6 +845,9 @@ object CStackData::GetItem(unsigned int iIndex)
     if (iIndex >= (unsigned int) m_pHook->GetArgumentCount())
         BOOST_RAISE_EXCEPTION(PyExc_IndexError, "Index out of range.")
 
+    if (!m_pHook->GetHookFrame())
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "The hook isn't executed anymore.")
+
     // Argument already cached?
     object retval = m_mapCache[iIndex];
     if (retval)
@@ -192,6 +881,9 @@ void CStackData::SetItem(unsigned int iIndex, object value)
     if (iIndex >= (unsigned int) m_pHook->GetArgumentCount())
         BOOST_RAISE_EXCEPTION(PyExc_IndexError, "Index out of range.")
 
+    if (!m_pHook->GetHookFrame())
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "The hook isn't executed anymore.")
+
     // Update cache
     m_mapCache[iIndex] = value;
     switch(m_pHook->GetArgument(iIndex)->m_cParam)
@@ -209,7 +901,7 @@ void CStackData::SetItem(unsigned int iIndex, object value)
         case SIGCHAR_ULONGLONG: SetArgument<unsigned long long>(m_pHook, iIndex, value); break;
         case SIGCHAR_FLOAT:     SetArgument<float>(m_pHook, iIndex, value); break;
         case SIGCHAR_DOUBLE:    SetArgument<double>(m_pHook, iIndex, value); break;
-        case SIGCHAR_POINTER:   SetArgument<unsigned long>(m_pHook, iIndex, object(ExtractPyPtr(value))); break;
+        case SIGCHAR_POINTER:   m_pHook->SetArgument<unsigned long>(iIndex, ExtractPyPtr(value)); break;
         case SIGCHAR_STRING:    SetArgument<const char *>(m_pHook, iIndex, value); break;
         default: BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Unknown type.")
     }
@@ -24,16 +24,124 @@
 // >> INCLUDES
 // ============================================================================
 #include <map>
+#include <vector>
 
 #include "DynamicHooks.h"
 using namespace DynamicHooks;
 
+#include "utilities.h"
+
 #include "binutils_tools.h"
+#include "binutils_hook_api.h"
 
 #include "boost/python.hpp"
 using namespace boost::python;
 
 
+// ============================================================================
+// >> CHookPredicate
+// ============================================================================
+enum PredicateOp_t
+{
+    PREDICATE_EQ,
+    PREDICATE_NE,
+    PREDICATE_LT,
+    PREDICATE_LE,
+    PREDICATE_GT,
+    PREDICATE_GE,
+
+    // (value & operand) != 0
+    PREDICATE_AND,
+
+    // Value is in a set of operands
+    PREDICATE_IN
+};
+
+struct PredicateTerm_t
+{
+    // Index of the argument
+    int                    m_iIndex;
+
+    // If true, the value is read from <argument> + m_iOffset
+    bool                   m_bDeref;
+    int                    m_iOffset;
+
+    // Width and signedness of the compared value. Operands are truncated and
+    // sign- or zero-extended to it, so -1 and 0xFFFFFFFF are the same operand
+    // for a 4 byte value.
+    int                    m_iSize;
+    bool                   m_bSigned;
+
+    // Applied to the value before it's compared
+    unsigned long long     m_ullMask;
+
+    PredicateOp_t          m_eOp;
+    long long              m_llOperand;
+
+    // Sorted operands of PREDICATE_IN
+    std::vector<long long> m_vecOperands;
+};
+
+/*
+    A condition for a Python hook callback, which is evaluated in C++ before
+    Python is entered. The callback is only called if all terms match. A
+    predicate can't be changed anymore after it has been registered.
+*/
+class CHookPredicate
+{
+public:
+    CHookPredicate();
+
+    // Adds a term that compares an integer or pointer argument
+    void Arg(int iIndex, const char* szOp, object oOperand, object oMask = object());
+
+    // Adds a term that compares the value at <argument> + <offset>
+    void Field(int iIndex, int iOffset, const char* szOp, object oOperand,
+        int iSize = 4, bool bSigned = false, object oMask = object());
+
+    // Raises an exception if the terms don't fit to the given parameters.
+    // Otherwise the operands are adjusted to the argument types.
+    void Validate(const char* szParams);
+
+    bool Evaluate(CHook* pHook);
+
+private:
+    void AddTerm(PredicateTerm_t& term, const char* szOp, object oOperand, object oMask);
+
+public:
+    std::vector<PredicateTerm_t> m_vecTerms;
+    bool                         m_bLocked;
+};
+
+
+// ============================================================================
+// >> Callback arrays
+// ============================================================================
+struct HookCallback_t
+{
+    PyObject*       m_pCallable;
+
+    // Optional predicate and the Python object that owns it
+    CHookPredicate* m_pPredicate;
+    PyObject*       m_pPredicateObj;
+};
+
+// An immutable array of Python callbacks. Adding or removing a callback
+// publishes a new array, so the hook handler can iterate without copying or
+// locking anything.
+struct CallbackArray_t
+{
+    int            m_iCount;
+    HookCallback_t m_Callbacks[1];
+};
+
+// Stored in CHook::m_pUserData
+struct HookCallbacks_t
+{
+    CallbackArray_t* volatile m_pArrays[2];
+};
+
+
 // ============================================================================
 // >> CLASSES
 // ============================================================================
@@ -56,4 +164,45 @@ private:
 // ============================================================================
 bool binutils_HookHandler(DynamicHooks::HookType_t eHookType, CHook* pHook);
 
+// Adds the callback to the callbacks of the given hook type. <oPredicate> is
+// either None or a CHookPredicate object, which has already been validated
+// for the hook.
+void AddHookCallback(CHook* pHook, HookType_t eHookType, PyObject* pCallable, object oPredicate = object());
+
+// Removes all occurrences of the callback. Returns the number of callbacks
+// that are left for the given hook type.
+int RemoveHookCallback(CHook* pHook, HookType_t eHookType, PyObject* pCallable);
+
+/*
+    Native callbacks are registered directly at DynamicHooks, so its hook
+    handler calls them next to binutils_HookHandler without entering Python.
+    They have the signature of HookFn and return true to override the return
+    value. They access the arguments through the NativeHookApi_t returned by
+    GetNativeHookApi().
+*/
+void AddNativeHookCallback(CHook* pHook, HookType_t eHookType, HookFn pCallback);
+void RemoveNativeHookCallback(CHook* pHook, HookType_t eHookType, HookFn pCallback);
+
+/*
+    Same as above, but <oCallback> can be an address, a Pointer object, a
+    ctypes function pointer or a (<library path>, <symbol name>) tuple.
+    ctypes function pointers are kept alive until they are removed. Loaded
+    libraries are never freed, because another thread might still execute
+    the callback.
+*/
+void AddNativeHookCallback(CHook* pHook, HookType_t eHookType, object oCallback);
+void RemoveNativeHookCallback(CHook* pHook, HookType_t eHookType, object oCallback);
+
+// Returns the address of the NativeHookApi_t for native callbacks
+CPointer GetNativeHookApi();
+
+// Returns the number of hooked functions
+int GetHookCount();
+
+/*
+    Returns a list of all hooks sorted by the address of the hooked function:
+    [(<function>, <trampoline>, <convention>, <parameters>), ...]
+*/
+list GetHooks();
+
 #endif // _BINUTILS_HOOKS_H
@@ -55,6 +55,19 @@ using namespace boost::python;
         PyErr_Clear(); \
     }
 
+// ============================================================================
+// Surround code in plain CPython functions with this macro if it might throw
+// boost exceptions. They are translated into Python exceptions.
+// ============================================================================
+#define BEGIN_CPYTHON_CALL() \
+    try {
+
+#define END_CPYTHON_CALL( retval ) \
+    } catch( ... ) { \
+        handle_exception(); \
+        return retval; \
+    }
+
 // ============================================================================
 // Use this macro to expose a variadic function.
 // ============================================================================
@@ -84,6 +97,70 @@ using namespace boost::python;
         throw_error_already_set(); \
     }
 
+// ============================================================================
+// Use this macro to give the CPU a hint that the given address will be read
+// soon. It never faults, so invalid addresses are fine.
+// ============================================================================
+#ifdef __GNUC__
+    #define PREFETCH(addr) __builtin_prefetch((const void *) (addr))
+#else
+    #define PREFETCH(addr)
+#endif
+
+// ============================================================================
+// Use this macro to declare a variable that exists once per thread. Only POD
+// types are supported.
+// ============================================================================
+#ifdef __GNUC__
+    #define THREAD_LOCAL __thread
+#else
+    #define THREAD_LOCAL __declspec(thread)
+#endif
+
+// ============================================================================
+// Use these macros to change a volatile long atomically. They return the new
+// value and act as a full memory barrier.
+// ============================================================================
+#ifdef __GNUC__
+    #define ATOMIC_INCREMENT(var) __sync_add_and_fetch(&(var), 1)
+    #define ATOMIC_DECREMENT(var) __sync_sub_and_fetch(&(var), 1)
+#else
+    #include <intrin.h>
+    #define ATOMIC_INCREMENT(var) _InterlockedIncrement(&(var))
+    #define ATOMIC_DECREMENT(var) _InterlockedDecrement(&(var))
+#endif
+
+// ============================================================================
+// Use this macro to execute a native call. If <bReleaseGIL> is true, other
+// Python threads can run during the call. Native code that calls back into
+// Python (hooks and callbacks) must acquire the GIL with CGILGuard.
+// ============================================================================
+#define NATIVE_CALL(bReleaseGIL, statement) \
+    if (bReleaseGIL) \
+    { \
+        Py_BEGIN_ALLOW_THREADS \
+        statement; \
+        Py_END_ALLOW_THREADS \
+    } \
+    else \
+    { \
+        statement; \
+    }
+
+// ============================================================================
+// Acquires the GIL for the lifetime of the object. Use it whenever native
+// code enters Python, because it might have been called without the GIL.
+// ============================================================================
+class CGILGuard
+{
+public:
+    CGILGuard()  { m_eState = PyGILState_Ensure(); }
+    ~CGILGuard() { PyGILState_Release(m_eState); }
+
+private:
+    PyGILState_STATE m_eState;
+};
+
 // ============================================================================
 // These typedefs save some typing. Use this policy for any functions that return
 // a newly allocated instance of a class which you need to delete yourself.
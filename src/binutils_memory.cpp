@@ -0,0 +1,692 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string.h>
+
+#include "binutils_memory.h"
+#include "binutils_batch.h"
+#include "binutils_macros.h"
+#include "binutils_scanner.h"
+#include "binutils_tools.h"
+
+
+// ============================================================================
+// >> HELPER FUNCTIONS
+// ============================================================================
+#define BITS_PER_WORD 32
+
+// Snapshots are compared block by block. Only blocks that differ are
+// compared byte by byte.
+#define DIFF_BLOCK_SIZE 64
+
+// Maximum number of changed ranges a single block can add
+#define DIFF_BLOCK_RANGES (DIFF_BLOCK_SIZE / 2 + 1)
+
+// Changed ranges are collected without the GIL. This is the minimum number
+// of ranges room is made for before the GIL is released.
+#define DIFF_RANGE_RESERVE 1024
+
+inline int CountTrailingZeros(unsigned int uiWord)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(uiWord);
+#else
+    int iBit = 0;
+    while (!(uiWord & 1))
+    {
+        uiWord >>= 1;
+        iBit++;
+    }
+    return iBit;
+#endif
+}
+
+inline int CountBits(unsigned int uiWord)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(uiWord);
+#else
+    int iCount = 0;
+    for (; uiWord; iCount++)
+        uiWord &= uiWord - 1;
+
+    return iCount;
+#endif
+}
+
+// Values don't need to be aligned to their size
+template<class T>
+inline T ReadUnaligned(const unsigned char* pData)
+{
+    T value;
+    memcpy(&value, pData, sizeof(T));
+    return value;
+}
+
+// The switch is resolved at compile time, because eScanType is a template
+// argument. That keeps the scan loops free of branches on the scan type.
+template<class T, ScanType_t eScanType>
+inline bool MatchesValue(T current, T previous, T value, T max)
+{
+    switch (eScanType)
+    {
+        case SCAN_EXACT:     return current == value;
+        case SCAN_RANGE:     return current >= value && current <= max;
+        case SCAN_UNKNOWN:   return true;
+        case SCAN_CHANGED:   return current != previous;
+        case SCAN_UNCHANGED: return current == previous;
+        case SCAN_INCREASED: return current > previous;
+        case SCAN_DECREASED: return current < previous;
+    }
+    return false;
+}
+
+template<class T, ScanType_t eScanType>
+size_t FirstScanSlots(ScanRegion_t& region, int iAlignment, T value, T max)
+{
+    const unsigned char* pCurrent = region.m_vecSnapshot.empty() ? NULL : &region.m_vecSnapshot[0];
+    unsigned int* pAlive = region.m_vecAlive.empty() ? NULL : &region.m_vecAlive[0];
+
+    size_t iCount = 0;
+    for (size_t i=0; i < region.m_iSlots; i++)
+    {
+        if (MatchesValue<T, eScanType>(ReadUnaligned<T>(pCurrent + i * iAlignment), T(), value, max))
+        {
+            pAlive[i / BITS_PER_WORD] |= 1u << (i % BITS_PER_WORD);
+            iCount++;
+        }
+    }
+    return iCount;
+}
+
+// Compares the memory with the snapshot. The snapshot is updated in place,
+// unless the slots overlap. Then the previous value of the next slot would be
+// overwritten and CValueScanner::UpdateSnapshot() has to update it afterwards.
+template<class T, ScanType_t eScanType>
+size_t NextScanSlots(ScanRegion_t& region, int iAlignment, T value, T max)
+{
+    const unsigned char* pCurrent = (const unsigned char *) region.m_ulAddr;
+    unsigned char* pPrevious = region.m_vecSnapshot.empty() ? NULL : &region.m_vecSnapshot[0];
+    bool bInPlace = iAlignment >= (int) sizeof(T);
+
+    size_t iCount = 0;
+    for (size_t iWord=0; iWord < region.m_vecAlive.size(); iWord++)
+    {
+        // Only visit the slots that are still candidates
+        unsigned int uiWord = region.m_vecAlive[iWord];
+        unsigned int uiResult = 0;
+        while (uiWord)
+        {
+            int iBit = CountTrailingZeros(uiWord);
+            uiWord &= uiWord - 1;
+
+            size_t iOffset = (iWord * BITS_PER_WORD + iBit) * iAlignment;
+            T current = ReadUnaligned<T>(pCurrent + iOffset);
+            if (MatchesValue<T, eScanType>(current, ReadUnaligned<T>(pPrevious + iOffset), value, max))
+            {
+                uiResult |= 1u << iBit;
+                if (bInPlace)
+                    memcpy(pPrevious + iOffset, &current, sizeof(T));
+            }
+        }
+        region.m_vecAlive[iWord] = uiResult;
+        iCount += CountBits(uiResult);
+    }
+    return iCount;
+}
+
+template<class T, ScanType_t eScanType>
+size_t ScanSlots(std::vector<ScanRegion_t>& vecRegions, bool bFirst, int iAlignment, T value, T max)
+{
+    size_t iCount = 0;
+    for (size_t i=0; i < vecRegions.size(); i++)
+    {
+        if (bFirst)
+            iCount += FirstScanSlots<T, eScanType>(vecRegions[i], iAlignment, value, max);
+        else
+            iCount += NextScanSlots<T, eScanType>(vecRegions[i], iAlignment, value, max);
+    }
+    return iCount;
+}
+
+template<class T>
+void ScanValues(std::vector<ScanRegion_t>& vecRegions, ScanType_t eScanType, bool bFirst, int iAlignment,
+    const void* pValue, const void* pMax, size_t& iCount)
+{
+    T value = pValue ? *(const T *) pValue : T();
+    T max = pMax ? *(const T *) pMax : T();
+
+    switch (eScanType)
+    {
+        case SCAN_EXACT:     iCount = ScanSlots<T, SCAN_EXACT>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_RANGE:     iCount = ScanSlots<T, SCAN_RANGE>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_UNKNOWN:   iCount = ScanSlots<T, SCAN_UNKNOWN>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_CHANGED:   iCount = ScanSlots<T, SCAN_CHANGED>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_UNCHANGED: iCount = ScanSlots<T, SCAN_UNCHANGED>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_INCREASED: iCount = ScanSlots<T, SCAN_INCREASED>(vecRegions, bFirst, iAlignment, value, max); break;
+        case SCAN_DECREASED: iCount = ScanSlots<T, SCAN_DECREASED>(vecRegions, bFirst, iAlignment, value, max); break;
+    }
+}
+
+
+// ============================================================================
+// >> Memory regions
+// ============================================================================
+inline void AddRegion(PyObject* pRegion, std::vector<MemoryRegion_t>& vecRegions)
+{
+    MemoryRegion_t region;
+    CBinaryFile* pBinary = GetPyInstance<CBinaryFile>(pRegion);
+    if (pBinary)
+    {
+        region.m_ulAddr = pBinary->GetAddress();
+        region.m_ulSize = pBinary->GetSize();
+    }
+    else
+    {
+        object oRegion = object(handle<>(borrowed(pRegion)));
+        if (!PySequence_Check(pRegion) || len(oRegion) != 2)
+            BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Expected a BinaryFile object or an (address, size) tuple.")
+
+        region.m_ulAddr = ExtractPyPtr(object(oRegion[0]));
+        region.m_ulSize = extract<unsigned long>(oRegion[1]);
+    }
+
+    if (!region.m_ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Region address is NULL.")
+
+    vecRegions.push_back(region);
+}
+
+void ExtractRegions(object oRegions, std::vector<MemoryRegion_t>& vecRegions)
+{
+    if (GetPyInstance<CBinaryFile>(oRegions.ptr()))
+    {
+        AddRegion(oRegions.ptr(), vecRegions);
+        return;
+    }
+
+    object oSequence = object(handle<>(PySequence_Fast(oRegions.ptr(), "Expected a sequence of regions.")));
+    Py_ssize_t iCount = PySequence_Fast_GET_SIZE(oSequence.ptr());
+    PyObject** pItems = PySequence_Fast_ITEMS(oSequence.ptr());
+
+    for (Py_ssize_t i=0; i < iCount; i++)
+        AddRegion(pItems[i], vecRegions);
+}
+
+
+// ============================================================================
+// >> CValueScanner
+// ============================================================================
+CValueScanner::CValueScanner(object oRegions, const char* szType, int iAlignment /* = 0 */)
+{
+    m_eType = ExtractNativeType(szType);
+    if (m_eType == NATIVE_STRING)
+    {
+        // Strings are scanned as byte patterns
+        m_iValueSize = 0;
+        m_iAlignment = iAlignment > 0 ? iAlignment : 1;
+    }
+    else
+    {
+        m_iValueSize = GetNativeTypeSize(m_eType);
+        m_iAlignment = iAlignment > 0 ? iAlignment : m_iValueSize;
+    }
+
+    ExtractRegions(oRegions, m_vecRegions);
+    m_iCount = 0;
+    m_bScanned = false;
+    m_bScanning = false;
+}
+
+// Must be called with the GIL held
+void CValueScanner::CheckNotScanning()
+{
+    if (m_bScanning)
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "Another thread is scanning with this scanner.")
+}
+
+void CValueScanner::ConvertValue(object oValue, std::vector<unsigned char>& vecBuffer)
+{
+    vecBuffer.clear();
+    if (oValue.is_none())
+        return;
+
+    if (m_eType != NATIVE_STRING)
+    {
+        vecBuffer.resize(GetNativeTypeSize(m_eType));
+        if (!WriteNativeValue(m_eType, (unsigned long) &vecBuffer[0], oValue.ptr()))
+            throw_error_already_set();
+
+        return;
+    }
+
+    object oBytes = oValue;
+    if (PyUnicode_Check(oValue.ptr()))
+        oBytes = object(handle<>(PyUnicode_AsUTF8String(oValue.ptr())));
+
+    if (!PyBytes_Check(oBytes.ptr()))
+        BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Expected a string.")
+
+    const unsigned char* pData = (const unsigned char *) PyBytes_AS_STRING(oBytes.ptr());
+    vecBuffer.assign(pData, pData + PyBytes_GET_SIZE(oBytes.ptr()));
+}
+
+// The snapshots must have been sized already, because this is called without
+// the GIL
+void CValueScanner::TakeSnapshot()
+{
+    for (size_t i=0; i < m_vecScanRegions.size(); i++)
+    {
+        ScanRegion_t& region = m_vecScanRegions[i];
+        if (!region.m_vecSnapshot.empty())
+            memcpy(&region.m_vecSnapshot[0], (void *) region.m_ulAddr, region.m_vecSnapshot.size());
+    }
+}
+
+// Copies the current values of the remaining candidates into the snapshot
+void CValueScanner::UpdateSnapshot()
+{
+    for (size_t i=0; i < m_vecScanRegions.size(); i++)
+    {
+        ScanRegion_t& region = m_vecScanRegions[i];
+        for (size_t iWord=0; iWord < region.m_vecAlive.size(); iWord++)
+        {
+            unsigned int uiWord = region.m_vecAlive[iWord];
+            while (uiWord)
+            {
+                int iBit = CountTrailingZeros(uiWord);
+                uiWord &= uiWord - 1;
+
+                size_t iOffset = (iWord * BITS_PER_WORD + iBit) * m_iAlignment;
+                memcpy(&region.m_vecSnapshot[iOffset], (void *) (region.m_ulAddr + iOffset), m_iValueSize);
+            }
+        }
+    }
+}
+
+size_t CValueScanner::ScanBytes(ScanType_t eScanType, bool bFirst)
+{
+    const unsigned char* pPattern = m_vecValue.empty() ? NULL : &m_vecValue[0];
+
+    size_t iCount = 0;
+    for (size_t i=0; i < m_vecScanRegions.size(); i++)
+    {
+        ScanRegion_t& region = m_vecScanRegions[i];
+        for (size_t iSlot=0; iSlot < region.m_iSlots; iSlot++)
+        {
+            unsigned int& uiWord = region.m_vecAlive[iSlot / BITS_PER_WORD];
+            unsigned int uiBit = 1u << (iSlot % BITS_PER_WORD);
+            if (!bFirst && !(uiWord & uiBit))
+                continue;
+
+            const unsigned char* pCurrent = bFirst ? &region.m_vecSnapshot[iSlot * m_iAlignment]
+                : (const unsigned char *) region.m_ulAddr + iSlot * m_iAlignment;
+            bool bMatches;
+            switch (eScanType)
+            {
+                case SCAN_EXACT:     bMatches = memcmp(pCurrent, pPattern, m_iValueSize) == 0; break;
+                case SCAN_CHANGED:   bMatches = memcmp(pCurrent, &region.m_vecSnapshot[iSlot * m_iAlignment], m_iValueSize) != 0; break;
+                default:             bMatches = memcmp(pCurrent, &region.m_vecSnapshot[iSlot * m_iAlignment], m_iValueSize) == 0; break;
+            }
+
+            if (bMatches)
+            {
+                uiWord |= uiBit;
+                iCount++;
+            }
+            else
+                uiWord &= ~uiBit;
+        }
+    }
+    return iCount;
+}
+
+int CValueScanner::FirstScan(ScanType_t eScanType, object oValue /* = object() */, object oMax /* = object() */)
+{
+    CheckNotScanning();
+    if (eScanType != SCAN_EXACT && eScanType != SCAN_RANGE && eScanType != SCAN_UNKNOWN)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Scan type is not allowed for a first scan.")
+
+    if (eScanType != SCAN_UNKNOWN && oValue.is_none())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Scan type requires a value.")
+
+    if (eScanType == SCAN_RANGE && oMax.is_none())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Range scans require a maximum value.")
+
+    ConvertValue(oValue, m_vecValue);
+    ConvertValue(oMax, m_vecMax);
+
+    if (m_eType == NATIVE_STRING)
+    {
+        if (eScanType != SCAN_EXACT)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Strings only support exact scans.")
+
+        if (m_vecValue.empty())
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pattern is empty.")
+
+        m_iValueSize = (int) m_vecValue.size();
+    }
+
+    // Split the regions into slots
+    m_vecScanRegions.clear();
+    m_vecScanRegions.resize(m_vecRegions.size());
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+    {
+        MemoryRegion_t& source = m_vecRegions[i];
+        ScanRegion_t& region = m_vecScanRegions[i];
+
+        unsigned long ulEnd = source.m_ulAddr + source.m_ulSize;
+        region.m_ulAddr = (source.m_ulAddr + m_iAlignment - 1) / m_iAlignment * m_iAlignment;
+        region.m_iSlots = 0;
+        if (region.m_ulAddr < ulEnd && ulEnd - region.m_ulAddr >= (unsigned long) m_iValueSize)
+            region.m_iSlots = (ulEnd - region.m_ulAddr - m_iValueSize) / m_iAlignment + 1;
+
+        // Allocate everything now, because the scan runs without the GIL
+        region.m_vecAlive.assign((region.m_iSlots + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
+        region.m_vecSnapshot.resize(region.m_iSlots ? (region.m_iSlots - 1) * m_iAlignment + m_iValueSize : 0);
+    }
+
+    const void* pValue = m_vecValue.empty() ? NULL : &m_vecValue[0];
+    const void* pMax = m_vecMax.empty() ? NULL : &m_vecMax[0];
+
+    m_bScanning = true;
+    Py_BEGIN_ALLOW_THREADS
+    TakeSnapshot();
+    if (m_eType == NATIVE_STRING)
+        m_iCount = ScanBytes(eScanType, true);
+    else
+        NATIVE_TYPE_DISPATCH(m_eType, ScanValues, m_vecScanRegions, eScanType, true, m_iAlignment, pValue, pMax, m_iCount)
+    Py_END_ALLOW_THREADS
+    m_bScanning = false;
+
+    m_bScanned = true;
+    return (int) m_iCount;
+}
+
+int CValueScanner::NextScan(ScanType_t eScanType, object oValue /* = object() */, object oMax /* = object() */)
+{
+    CheckNotScanning();
+    if (!m_bScanned)
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "No first scan has been done yet.")
+
+    if (eScanType == SCAN_UNKNOWN)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Scan type is not allowed for a next scan.")
+
+    if ((eScanType == SCAN_EXACT || eScanType == SCAN_RANGE) && oValue.is_none())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Scan type requires a value.")
+
+    if (eScanType == SCAN_RANGE && oMax.is_none())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Range scans require a maximum value.")
+
+    if (m_eType == NATIVE_STRING)
+    {
+        if (eScanType != SCAN_EXACT && eScanType != SCAN_CHANGED && eScanType != SCAN_UNCHANGED)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Strings only support exact, changed and unchanged scans.")
+    }
+
+    ConvertValue(oValue, m_vecValue);
+    ConvertValue(oMax, m_vecMax);
+
+    // The pattern can't grow, because the slots have already been created
+    if (m_eType == NATIVE_STRING && eScanType == SCAN_EXACT && m_vecValue.size() != (size_t) m_iValueSize)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pattern length differs from the first scan.")
+
+    const void* pValue = m_vecValue.empty() ? NULL : &m_vecValue[0];
+    const void* pMax = m_vecMax.empty() ? NULL : &m_vecMax[0];
+
+    // Only the remaining candidates are read from the memory, so nothing needs
+    // to be allocated here
+    m_bScanning = true;
+    Py_BEGIN_ALLOW_THREADS
+    if (m_eType == NATIVE_STRING)
+        m_iCount = ScanBytes(eScanType, false);
+    else
+        NATIVE_TYPE_DISPATCH(m_eType, ScanValues, m_vecScanRegions, eScanType, false, m_iAlignment, pValue, pMax, m_iCount)
+
+    // Byte patterns and overlapping values are not updated by the scan itself
+    if (m_eType == NATIVE_STRING || m_iAlignment < m_iValueSize)
+        UpdateSnapshot();
+    Py_END_ALLOW_THREADS
+    m_bScanning = false;
+
+    return (int) m_iCount;
+}
+
+void CValueScanner::Reset()
+{
+    CheckNotScanning();
+    m_vecScanRegions.clear();
+    m_iCount = 0;
+    m_bScanned = false;
+}
+
+object CValueScanner::GetResults(int iLimit /* = -1 */)
+{
+    CheckNotScanning();
+    size_t iMax = iLimit < 0 ? m_iCount : (size_t) iLimit;
+
+    std::vector<unsigned long> vecResults;
+    vecResults.reserve(iMax < m_iCount ? iMax : m_iCount);
+    for (size_t i=0; i < m_vecScanRegions.size() && vecResults.size() < iMax; i++)
+    {
+        ScanRegion_t& region = m_vecScanRegions[i];
+        for (size_t iWord=0; iWord < region.m_vecAlive.size() && vecResults.size() < iMax; iWord++)
+        {
+            unsigned int uiWord = region.m_vecAlive[iWord];
+            while (uiWord && vecResults.size() < iMax)
+            {
+                int iBit = CountTrailingZeros(uiWord);
+                uiWord &= uiWord - 1;
+                vecResults.push_back(region.m_ulAddr + (iWord * BITS_PER_WORD + iBit) * m_iAlignment);
+            }
+        }
+    }
+
+    return CreatePyArray(NATIVE_PTR, vecResults.empty() ? NULL : &vecResults[0], vecResults.size());
+}
+
+
+// ============================================================================
+// >> CSnapshot
+// ============================================================================
+// Appends the changed ranges of the region, starting at the block at
+// <ulBlock>. Ranges that are not more than <iMergeDistance> bytes apart are
+// merged. Ranges before <iFirstRange> belong to other regions. This is called
+// without the GIL, so it never allocates. It returns the offset of the next
+// block if <vecRanges> has no room for another block or the size of the
+// region if it's done.
+unsigned long FindChangedRanges(SnapshotRegion_t& region, std::vector<ChangedRange_t>& vecRanges,
+    size_t iFirstRange, int iMergeDistance, unsigned long ulBlock)
+{
+    const unsigned char* pOld = region.m_vecData.empty() ? NULL : &region.m_vecData[0];
+    const unsigned char* pNew = (const unsigned char *) region.m_Region.m_ulAddr;
+    unsigned long ulSize = region.m_Region.m_ulSize;
+
+    for (; ulBlock < ulSize; ulBlock += DIFF_BLOCK_SIZE)
+    {
+        if (vecRanges.capacity() - vecRanges.size() < DIFF_BLOCK_RANGES)
+            return ulBlock;
+
+        unsigned long ulBlockEnd = ulBlock + DIFF_BLOCK_SIZE < ulSize ? ulBlock + DIFF_BLOCK_SIZE : ulSize;
+        if (memcmp(pOld + ulBlock, pNew + ulBlock, ulBlockEnd - ulBlock) == 0)
+            continue;
+
+        for (unsigned long i=ulBlock; i < ulBlockEnd; i++)
+        {
+            if (pOld[i] == pNew[i])
+                continue;
+
+            unsigned long ulStart = i;
+            while (i < ulBlockEnd && pOld[i] != pNew[i])
+                i++;
+
+            unsigned long ulAddr = region.m_Region.m_ulAddr + ulStart;
+            if (vecRanges.size() > iFirstRange)
+            {
+                ChangedRange_t& last = vecRanges.back();
+                if (last.m_ulAddr + last.m_ulSize + iMergeDistance >= ulAddr)
+                {
+                    last.m_ulSize = ulAddr + (i - ulStart) - last.m_ulAddr;
+                    continue;
+                }
+            }
+
+            ChangedRange_t range = {ulAddr, i - ulStart};
+            vecRanges.push_back(range);
+        }
+    }
+    return ulSize;
+}
+
+// Appends the changed ranges of the region. Room for the ranges is made with
+// the GIL held and only the comparison runs without it.
+void CollectChangedRanges(SnapshotRegion_t& region, std::vector<ChangedRange_t>& vecRanges, int iMergeDistance)
+{
+    size_t iFirstRange = vecRanges.size();
+    unsigned long ulBlock = 0;
+    while (ulBlock < region.m_Region.m_ulSize)
+    {
+        vecRanges.reserve(vecRanges.size() * 2 + DIFF_RANGE_RESERVE);
+
+        Py_BEGIN_ALLOW_THREADS
+        ulBlock = FindChangedRanges(region, vecRanges, iFirstRange, iMergeDistance, ulBlock);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+CSnapshot::CSnapshot(object oRegions)
+{
+    std::vector<MemoryRegion_t> vecRegions;
+    ExtractRegions(oRegions, vecRegions);
+
+    m_vecRegions.resize(vecRegions.size());
+    for (size_t i=0; i < vecRegions.size(); i++)
+        m_vecRegions[i].m_Region = vecRegions[i];
+
+    Update();
+}
+
+void CSnapshot::Update()
+{
+    // Allocate everything now, because the copy runs without the GIL
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+        m_vecRegions[i].m_vecData.resize(m_vecRegions[i].m_Region.m_ulSize);
+
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+    {
+        SnapshotRegion_t& region = m_vecRegions[i];
+        if (!region.m_vecData.empty())
+            memcpy(&region.m_vecData[0], (void *) region.m_Region.m_ulAddr, region.m_vecData.size());
+    }
+    Py_END_ALLOW_THREADS
+}
+
+void CSnapshot::Restore()
+{
+    Py_BEGIN_ALLOW_THREADS
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+    {
+        SnapshotRegion_t& region = m_vecRegions[i];
+        if (!region.m_vecData.empty())
+            memcpy((void *) region.m_Region.m_ulAddr, &region.m_vecData[0], region.m_vecData.size());
+    }
+    Py_END_ALLOW_THREADS
+}
+
+list CSnapshot::Diff(int iMergeDistance /* = 0 */)
+{
+    if (iMergeDistance < 0)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Merge distance must not be negative.")
+
+    std::vector<ChangedRange_t> vecRanges;
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+        CollectChangedRanges(m_vecRegions[i], vecRanges, iMergeDistance);
+
+    list result;
+    for (size_t i=0; i < vecRanges.size(); i++)
+        result.append(make_tuple(CPointer(vecRanges[i].m_ulAddr), vecRanges[i].m_ulSize));
+
+    return result;
+}
+
+list CSnapshot::DiffFields(const char* szType, int iAlignment /* = 0 */)
+{
+    NativeType_t eType = ExtractNativeType(szType);
+    if (eType == NATIVE_STRING)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Strings are not supported.")
+
+    unsigned long ulFieldSize = GetNativeTypeSize(eType);
+    unsigned long ulAlignment = iAlignment > 0 ? iAlignment : ulFieldSize;
+
+    list result;
+    for (size_t iRegion=0; iRegion < m_vecRegions.size(); iRegion++)
+    {
+        SnapshotRegion_t& region = m_vecRegions[iRegion];
+        unsigned long ulBase = region.m_Region.m_ulAddr;
+        unsigned long ulSize = region.m_Region.m_ulSize;
+        if (ulSize < ulFieldSize)
+            continue;
+
+        std::vector<ChangedRange_t> vecRanges;
+        CollectChangedRanges(region, vecRanges, 0);
+
+        // Offset of the next field that hasn't been checked yet
+        unsigned long ulNextField = 0;
+        for (size_t i=0; i < vecRanges.size(); i++)
+        {
+            unsigned long ulStart = vecRanges[i].m_ulAddr - ulBase;
+            unsigned long ulEnd = ulStart + vecRanges[i].m_ulSize;
+
+            // First field that overlaps the range
+            unsigned long ulField = 0;
+            if (ulStart + 1 > ulFieldSize)
+                ulField = (ulStart + 1 - ulFieldSize + ulAlignment - 1) / ulAlignment * ulAlignment;
+
+            if (ulField < ulNextField)
+                ulField = ulNextField;
+
+            for (; ulField < ulEnd && ulField + ulFieldSize <= ulSize; ulField += ulAlignment)
+            {
+                const unsigned char* pOld = &region.m_vecData[ulField];
+                const unsigned char* pNew = (const unsigned char *) (ulBase + ulField);
+                if (memcmp(pOld, pNew, ulFieldSize) == 0)
+                    continue;
+
+                object oOld = object(handle<>(ReadNativeValue(eType, (unsigned long) pOld)));
+                object oNew = object(handle<>(ReadNativeValue(eType, (unsigned long) pNew)));
+                result.append(make_tuple(CPointer(ulBase + ulField), oOld, oNew));
+            }
+            ulNextField = ulField;
+        }
+    }
+    return result;
+}
+
+unsigned long CSnapshot::GetSize()
+{
+    unsigned long ulSize = 0;
+    for (size_t i=0; i < m_vecRegions.size(); i++)
+        ulSize += m_vecRegions[i].m_vecData.size();
+
+    return ulSize;
+}
@@ -0,0 +1,165 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_MEMORY_H
+#define _BINUTILS_MEMORY_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <vector>
+
+#include "binutils_convert.h"
+
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> Memory regions
+// ============================================================================
+struct MemoryRegion_t
+{
+    unsigned long m_ulAddr;
+    unsigned long m_ulSize;
+};
+
+/*
+    Fills the vector with the regions of the given object. Accepted are a
+    BinaryFile object or a sequence of BinaryFile objects and
+    (address, size) tuples.
+*/
+void ExtractRegions(object oRegions, std::vector<MemoryRegion_t>& vecRegions);
+
+
+// ============================================================================
+// >> CValueScanner
+// ============================================================================
+enum ScanType_t
+{
+    // First scans
+    SCAN_EXACT,
+    SCAN_RANGE,
+    SCAN_UNKNOWN,
+
+    // Next scans (SCAN_EXACT and SCAN_RANGE are also allowed)
+    SCAN_CHANGED,
+    SCAN_UNCHANGED,
+    SCAN_INCREASED,
+    SCAN_DECREASED
+};
+
+struct ScanRegion_t
+{
+    // Address of the first slot
+    unsigned long              m_ulAddr;
+    size_t                     m_iSlots;
+
+    // Values of the last scan. Next scans compare them with the memory and
+    // only update the values of the remaining candidates.
+    std::vector<unsigned char> m_vecSnapshot;
+
+    // A bit for every slot that is still a candidate
+    std::vector<unsigned int>  m_vecAlive;
+};
+
+/*
+    Searches the given regions for a value, like Cheat Engine does. A first
+    scan creates the candidates and every next scan removes the candidates
+    that don't match anymore. Candidates are stored as a bitmap per region,
+    so millions of them are cheap.
+*/
+class CValueScanner
+{
+public:
+    CValueScanner(object oRegions, const char* szType, int iAlignment = 0);
+
+    int    FirstScan(ScanType_t eScanType, object oValue = object(), object oMax = object());
+    int    NextScan(ScanType_t eScanType, object oValue = object(), object oMax = object());
+    void   Reset();
+
+    object GetResults(int iLimit = -1);
+    int    GetCount() { return (int) m_iCount; }
+
+private:
+    void   CheckNotScanning();
+    void   ConvertValue(object oValue, std::vector<unsigned char>& vecBuffer);
+    void   TakeSnapshot();
+    void   UpdateSnapshot();
+    size_t ScanBytes(ScanType_t eScanType, bool bFirst);
+
+public:
+    NativeType_t               m_eType;
+    int                        m_iAlignment;
+
+private:
+    std::vector<MemoryRegion_t> m_vecRegions;
+    std::vector<ScanRegion_t>   m_vecScanRegions;
+    size_t                      m_iCount;
+    bool                        m_bScanned;
+
+    // True while a scan runs without the GIL. Other Python threads must not
+    // touch the buffers meanwhile.
+    bool                        m_bScanning;
+
+    // Size of a value. Depends on the pattern when scanning for strings
+    int                         m_iValueSize;
+    std::vector<unsigned char>  m_vecValue;
+    std::vector<unsigned char>  m_vecMax;
+};
+
+
+// ============================================================================
+// >> CSnapshot
+// ============================================================================
+struct SnapshotRegion_t
+{
+    MemoryRegion_t             m_Region;
+    std::vector<unsigned char> m_vecData;
+};
+
+// A range of bytes that differs from the snapshot
+struct ChangedRange_t
+{
+    unsigned long m_ulAddr;
+    unsigned long m_ulSize;
+};
+
+/*
+    Stores a copy of the given regions, so they can be compared with or reset
+    to their state at the time of the snapshot.
+*/
+class CSnapshot
+{
+public:
+    CSnapshot(object oRegions);
+
+    void   Update();
+    void   Restore();
+
+    list   Diff(int iMergeDistance = 0);
+    list   DiffFields(const char* szType, int iAlignment = 0);
+
+    unsigned long GetSize();
+
+private:
+    std::vector<SnapshotRegion_t> m_vecRegions;
+};
+
+#endif // _BINUTILS_MEMORY_H
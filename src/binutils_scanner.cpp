@@ -44,18 +44,18 @@ CBinaryFile::CBinaryFile(unsigned long ulAddr, unsigned long ulSize)
     m_ulSize = ulSize;
 }
 
-CPointer* CBinaryFile::FindSignature(object szSignature)
+CPointer CBinaryFile::FindSignature(object szSignature)
 {
     unsigned char* sigstr = GetByteRepr(szSignature);
     if (!sigstr)
-        return new CPointer();
+        return CPointer();
 
     // Search for a cached signature
     for (std::list<Signature_t>::iterator iter=m_Signatures.begin(); iter != m_Signatures.end(); iter++)
     {
         Signature_t sig = *iter;
         if (strcmp((const char *) sig.m_szSignature, (const char *) sigstr) == 0)
-            return new CPointer(sig.m_ulAddr);
+            return CPointer(sig.m_ulAddr);
     }
 
     int iLength = len(szSignature);
@@ -83,17 +83,17 @@ CPointer* CBinaryFile::FindSignature(object szSignature)
             Signature_t sig_t = {new unsigned char[iLength+1], ulAddr};
             strcpy((char*) sig_t.m_szSignature, (char*) sigstr);
             m_Signatures.push_back(sig_t);
-            return new CPointer(ulAddr);
+            return CPointer(ulAddr);
         }
         base++;
     }
-    return new CPointer();
+    return CPointer();
 }
 
-CPointer* CBinaryFile::FindSymbol(char* szSymbol)
+CPointer CBinaryFile::FindSymbol(char* szSymbol)
 {
 #ifdef _WIN32
-    return new CPointer((unsigned long) GetProcAddress((HMODULE) m_ulAddr, szSymbol));
+    return CPointer((unsigned long) GetProcAddress((HMODULE) m_ulAddr, szSymbol));
 
 #elif defined(__linux__)
     // -----------------------------------------
@@ -123,7 +123,7 @@ CPointer* CBinaryFile::FindSymbol(char* szSymbol)
     if (dlfile == -1 || fstat(dlfile, &dlstat) == -1)
     {
         close(dlfile);
-        return new CPointer();
+        return CPointer();
     }
 
     /* Map library file into memory */
@@ -132,14 +132,14 @@ CPointer* CBinaryFile::FindSymbol(char* szSymbol)
     if (file_hdr == MAP_FAILED)
     {
         close(dlfile);
-        return new CPointer();
+        return CPointer();
     }
     close(dlfile);
 
     if (file_hdr->e_shoff == 0 || file_hdr->e_shstrndx == SHN_UNDEF)
     {
         munmap(file_hdr, dlstat.st_size);
-        return new CPointer();
+        return CPointer();
     }
 
     sections = (Elf32_Shdr *)(map_base + file_hdr->e_shoff);
@@ -165,7 +165,7 @@ CPointer* CBinaryFile::FindSymbol(char* szSymbol)
     if (symtab_hdr == NULL || strtab_hdr == NULL)
     {
         munmap(file_hdr, dlstat.st_size);
-        return new CPointer();
+        return CPointer();
     }
 
     symtab = (Elf32_Sym *)(map_base + symtab_hdr->sh_offset);
@@ -193,17 +193,17 @@ CPointer* CBinaryFile::FindSymbol(char* szSymbol)
 
     // Unmap the file now.
     munmap(file_hdr, dlstat.st_size);
-    return new CPointer((unsigned long) sym_addr);
+    return CPointer((unsigned long) sym_addr);
 
 #else
 #error "CBinaryFile::FindSymbol() is not implemented on this OS"
 #endif
 }
 
-CPointer* CBinaryFile::FindPointer(object szSignature, int iOffset)
+CPointer CBinaryFile::FindPointer(object szSignature, int iOffset)
 {
-    CPointer* ptr = FindSignature(szSignature);
-    return !ptr->m_ulAddr ? ptr->GetPtr(iOffset) : ptr;
+    CPointer ptr = FindSignature(szSignature);
+    return ptr.m_ulAddr ? ptr.GetPtr(iOffset) : ptr;
 }
 
 // ============================================================================
@@ -42,9 +42,9 @@ class CBinaryFile
 public:
     CBinaryFile(unsigned long ulAddr, unsigned long ulSize);
 
-    CPointer* FindSignature(object szSignature);
-    CPointer* FindSymbol(char* szSymbol);
-    CPointer* FindPointer(object szSignature, int iOffset);
+    CPointer FindSignature(object szSignature);
+    CPointer FindSymbol(char* szSymbol);
+    CPointer FindPointer(object szSignature, int iOffset);
 
     unsigned long GetAddress() { return m_ulAddr; }
     unsigned long GetSize() { return m_ulSize; }
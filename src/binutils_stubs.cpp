@@ -0,0 +1,319 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <map>
+#include <string>
+
+#include "dyncall_signature.h"
+
+#include "binutils_stubs.h"
+#include "binutils_convert.h"
+#include "binutils_macros.h"
+
+#include "AsmJit.h"
+using namespace AsmJit;
+
+
+// ============================================================================
+// >> Stub cache
+// ============================================================================
+struct StubKey_t
+{
+    unsigned long m_ulAddr;
+    Convention_t  m_eConv;
+    std::string   m_szParams;
+
+    bool operator<(const StubKey_t& other) const
+    {
+        if (m_ulAddr != other.m_ulAddr)
+            return m_ulAddr < other.m_ulAddr;
+
+        if (m_eConv != other.m_eConv)
+            return m_eConv < other.m_eConv;
+
+        return m_szParams < other.m_szParams;
+    }
+};
+
+std::map<StubKey_t, CallStub_t *> g_mapCallStubs;
+
+
+// ============================================================================
+// >> Argument writers
+// ============================================================================
+template<class T>
+bool WriteStubArg(PyObject* pArg, unsigned long* pSlot)
+{
+    T value;
+    if (!FromPyObject<T>(pArg, value))
+        return false;
+
+    // Small values are extended to a full slot like the compiler would do it
+    if (sizeof(T) < sizeof(unsigned long))
+        *pSlot = (unsigned long) (long) value;
+    else
+        memcpy(pSlot, &value, sizeof(T));
+
+    return true;
+}
+
+bool WriteStubPointer(PyObject* pArg, unsigned long* pSlot)
+{
+    if (!TryExtractPyPtr(pArg, *pSlot))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected an address or a Pointer object.");
+        return false;
+    }
+    return true;
+}
+
+bool WriteStubString(PyObject* pArg, unsigned long* pSlot)
+{
+    const char* szValue;
+    if (!FromPyObject<const char *>(pArg, szValue))
+        return false;
+
+    *pSlot = (unsigned long) szValue;
+    return true;
+}
+
+// Returns the writer and the number of slots of a parameter type or NULL if
+// the type is unknown.
+StubArgWriter_t GetStubArgWriter(char ch, int& iSlots)
+{
+    iSlots = 1;
+    switch(ch)
+    {
+        case DC_SIGCHAR_BOOL:      return &WriteStubArg<bool>;
+        case DC_SIGCHAR_CHAR:      return &WriteStubArg<char>;
+        case DC_SIGCHAR_UCHAR:     return &WriteStubArg<unsigned char>;
+        case DC_SIGCHAR_SHORT:     return &WriteStubArg<short>;
+        case DC_SIGCHAR_USHORT:    return &WriteStubArg<unsigned short>;
+        case DC_SIGCHAR_INT:       return &WriteStubArg<int>;
+        case DC_SIGCHAR_UINT:      return &WriteStubArg<unsigned int>;
+        case DC_SIGCHAR_LONG:      return &WriteStubArg<long>;
+        case DC_SIGCHAR_ULONG:     return &WriteStubArg<unsigned long>;
+        case DC_SIGCHAR_FLOAT:     return &WriteStubArg<float>;
+        case DC_SIGCHAR_POINTER:   return &WriteStubPointer;
+        case DC_SIGCHAR_STRING:    return &WriteStubString;
+    }
+
+    iSlots = 2;
+    switch(ch)
+    {
+        case DC_SIGCHAR_LONGLONG:  return &WriteStubArg<long long>;
+        case DC_SIGCHAR_ULONGLONG: return &WriteStubArg<unsigned long long>;
+        case DC_SIGCHAR_DOUBLE:    return &WriteStubArg<double>;
+    }
+    return NULL;
+}
+
+
+// ============================================================================
+// >> Return value readers
+// ============================================================================
+template<class T>
+object ReadStubReturn(void* pReturn, object& oConverter)
+{
+    return object(handle<>(ToPyObject<T>(*(T *) pReturn)));
+}
+
+object ReadStubVoid(void* pReturn, object& oConverter)
+{
+    return object();
+}
+
+object ReadStubPointer(void* pReturn, object& oConverter)
+{
+    return oConverter(CPointer(*(unsigned long *) pReturn));
+}
+
+StubReturnReader_t GetStubReturnReader(char ch)
+{
+    switch(ch)
+    {
+        case DC_SIGCHAR_VOID:      return &ReadStubVoid;
+        case DC_SIGCHAR_BOOL:      return &ReadStubReturn<bool>;
+        case DC_SIGCHAR_CHAR:      return &ReadStubReturn<char>;
+        case DC_SIGCHAR_UCHAR:     return &ReadStubReturn<unsigned char>;
+        case DC_SIGCHAR_SHORT:     return &ReadStubReturn<short>;
+        case DC_SIGCHAR_USHORT:    return &ReadStubReturn<unsigned short>;
+        case DC_SIGCHAR_INT:       return &ReadStubReturn<int>;
+        case DC_SIGCHAR_UINT:      return &ReadStubReturn<unsigned int>;
+        case DC_SIGCHAR_LONG:      return &ReadStubReturn<long>;
+        case DC_SIGCHAR_ULONG:     return &ReadStubReturn<unsigned long>;
+        case DC_SIGCHAR_LONGLONG:  return &ReadStubReturn<long long>;
+        case DC_SIGCHAR_ULONGLONG: return &ReadStubReturn<unsigned long long>;
+        case DC_SIGCHAR_FLOAT:     return &ReadStubReturn<float>;
+        case DC_SIGCHAR_DOUBLE:    return &ReadStubReturn<double>;
+        case DC_SIGCHAR_POINTER:   return &ReadStubPointer;
+        case DC_SIGCHAR_STRING:    return &ReadStubReturn<const char *>;
+    }
+    return NULL;
+}
+
+
+// ============================================================================
+// >> Code generation
+// ============================================================================
+StubCode_t CreateStubCode(CallStub_t* pStub, int iSlots, char cReturn)
+{
+    Assembler a;
+
+    // Set up a frame, so we can restore esp regardless of who cleans up the
+    // stack
+    a.push(ebp);
+    a.mov(ebp, esp);
+    a.push(esi);
+
+    // esi = pArgs
+    a.mov(esi, dword_ptr(ebp, 8));
+
+    // On Windows the this pointer is passed in ecx instead of the stack
+    int iFirstArg = 0;
+#ifdef _WIN32
+    if (pStub->m_eConv == CONV_THISCALL && !pStub->m_vecArgs.empty())
+    {
+        a.mov(ecx, dword_ptr(esi, 0));
+        iSlots -= pStub->m_vecArgs[0].m_iSlots;
+        iFirstArg = 1;
+    }
+#endif
+
+    // Keep the stack 16 byte aligned at the call
+    a.and_(esp, imm(-16));
+    if (iSlots % 4)
+        a.sub(esp, imm((4 - iSlots % 4) * 4));
+
+    // Push the arguments from right to left. The high part of 64 bit values
+    // is pushed first.
+    for (int i=(int) pStub->m_vecArgs.size() - 1; i >= iFirstArg; i--)
+    {
+        StubArg_t& arg = pStub->m_vecArgs[i];
+        for (int iSlot=arg.m_iSlot + arg.m_iSlots - 1; iSlot >= arg.m_iSlot; iSlot--)
+            a.push(dword_ptr(esi, iSlot * 4));
+    }
+
+    a.call((void *) pStub->m_ulAddr);
+
+    // ecx = pReturn
+    a.mov(ecx, dword_ptr(ebp, 12));
+    switch(cReturn)
+    {
+        case DC_SIGCHAR_VOID: break;
+        case DC_SIGCHAR_FLOAT:  a.fstp(dword_ptr(ecx)); break;
+        case DC_SIGCHAR_DOUBLE: a.fstp(qword_ptr(ecx)); break;
+        case DC_SIGCHAR_LONGLONG:
+        case DC_SIGCHAR_ULONGLONG:
+            a.mov(dword_ptr(ecx, 4), edx);
+            // Fall through
+        default:
+            a.mov(dword_ptr(ecx), eax);
+    }
+
+    a.lea(esp, dword_ptr(ebp, -4));
+    a.pop(esi);
+    a.pop(ebp);
+    a.ret();
+
+    return (StubCode_t) a.make();
+}
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+CallStub_t* GetCallStub(unsigned long ulAddr, Convention_t eConv, const char* szParams)
+{
+    if (!ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
+
+    StubKey_t key;
+    key.m_ulAddr = ulAddr;
+    key.m_eConv = eConv;
+    key.m_szParams = szParams;
+
+    std::map<StubKey_t, CallStub_t *>::iterator it = g_mapCallStubs.find(key);
+    if (it != g_mapCallStubs.end())
+        return it->second;
+
+    std::vector<StubArg_t> vecArgs;
+    int iSlots = 0;
+    const char* ptr = szParams;
+
+    // A leading "v" means that the function doesn't take any arguments
+    if (*ptr == DC_SIGCHAR_VOID)
+        ptr++;
+
+    for (; *ptr != '\0' && *ptr != ')'; ptr++)
+    {
+        StubArg_t arg;
+        arg.m_pWriter = GetStubArgWriter(*ptr, arg.m_iSlots);
+        if (!arg.m_pWriter)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Unknown parameter type.")
+
+        arg.m_iSlot = iSlots;
+        iSlots += arg.m_iSlots;
+        vecArgs.push_back(arg);
+    }
+
+    if (iSlots > MAX_STUB_SLOTS)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Too many parameters to compile the function.")
+
+    if (*ptr == '\0')
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "String parameter has no return type.")
+
+    char cReturn = *++ptr;
+    StubReturnReader_t pReturnReader = GetStubReturnReader(cReturn);
+    if (!pReturnReader)
+        BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Unknown return type.")
+
+    CallStub_t* pStub = new CallStub_t;
+    pStub->m_ulAddr = ulAddr;
+    pStub->m_eConv = eConv;
+    pStub->m_vecArgs.swap(vecArgs);
+    pStub->m_pReturnReader = pReturnReader;
+    pStub->m_pCode = CreateStubCode(pStub, iSlots, cReturn);
+    if (!pStub->m_pCode)
+    {
+        delete pStub;
+        BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "Failed to generate the call stub.")
+    }
+
+    g_mapCallStubs[key] = pStub;
+    return pStub;
+}
+
+object CallStub(CallStub_t* pStub, PyObject** ppArgs, object& oConverter, bool bReleaseGIL /* = false */)
+{
+    unsigned long pSlots[MAX_STUB_SLOTS];
+    for (size_t i=0; i < pStub->m_vecArgs.size(); i++)
+    {
+        StubArg_t& arg = pStub->m_vecArgs[i];
+        if (!arg.m_pWriter(ppArgs[i], &pSlots[arg.m_iSlot]))
+            throw_error_already_set();
+    }
+
+    unsigned long long ullReturn = 0;
+    NATIVE_CALL(bReleaseGIL, pStub->m_pCode(pSlots, &ullReturn))
+    return pStub->m_pReturnReader(&ullReturn, oConverter);
+}
@@ -0,0 +1,88 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_STUBS_H
+#define _BINUTILS_STUBS_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <vector>
+
+#include "binutils_tools.h"
+
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> DEFINITIONS
+// ============================================================================
+// Maximum number of 4 byte slots a compiled call can pass. 64 bit values
+// require two slots.
+#define MAX_STUB_SLOTS 64
+
+// Converts a Python object and stores it in the argument slots. Returns false
+// and sets a Python error if the conversion failed.
+typedef bool (*StubArgWriter_t)(PyObject* pArg, unsigned long* pSlot);
+
+// Converts the raw return value into a Python object.
+typedef object (*StubReturnReader_t)(void* pReturn, object& oConverter);
+
+// The generated code. It pushes the arguments from <pArgs>, calls the
+// function and stores the return value in <pReturn>.
+typedef void (*StubCode_t)(const unsigned long* pArgs, void* pReturn);
+
+
+// ============================================================================
+// >> CallStub_t
+// ============================================================================
+struct StubArg_t
+{
+    StubArgWriter_t m_pWriter;
+    int             m_iSlot;
+    int             m_iSlots;
+};
+
+struct CallStub_t
+{
+    unsigned long          m_ulAddr;
+    Convention_t           m_eConv;
+
+    std::vector<StubArg_t> m_vecArgs;
+    StubReturnReader_t     m_pReturnReader;
+    StubCode_t             m_pCode;
+};
+
+/*
+    Returns a call stub for the given function. Stubs are generated with
+    AsmJit and cached by address, convention and parameter string, so all
+    Function objects of the same function share one stub. Stubs are never
+    freed.
+*/
+CallStub_t* GetCallStub(unsigned long ulAddr, Convention_t eConv, const char* szParams);
+
+/*
+    Converts the arguments and calls the stub. <ppArgs> must contain exactly
+    one object per parameter. The GIL is released during the call if
+    <bReleaseGIL> is true.
+*/
+object CallStub(CallStub_t* pStub, PyObject** ppArgs, object& oConverter, bool bReleaseGIL = false);
+
+#endif // _BINUTILS_STUBS_H
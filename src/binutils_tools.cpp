@@ -27,12 +27,20 @@
 #include "dyncall_signature.h"
 
 #include "binutils_tools.h"
+#include "binutils_convert.h"
 #include "binutils_macros.h"
 #include "binutils_hooks.h"
+#include "binutils_stubs.h"
+#include "binutils_batch.h"
 
 
-DCCallVM* g_pCallVM = dcNewCallVM(4096);
-extern std::map<CHook *, std::map<DynamicHooks::HookType_t, std::list<PyObject *> > > g_mapCallbacks;
+bool g_bProfileCalls = false;
+
+// Every thread uses its own call VM, so calls from different threads don't
+// mix up their arguments. g_iCallVMMode is the mode that was set last.
+THREAD_LOCAL DCCallVM* g_pCallVM = NULL;
+THREAD_LOCAL int       g_iCallVMMode = -1;
+
 
 CHookManager* g_pHookMngr = GetHookManager();
 
@@ -47,6 +55,18 @@ inline size_t UTIL_GetSize(void* ptr)
 #endif
 }
 
+// Returns a converter that returns the passed object. It's only created once,
+// because eval() is expensive.
+object GetIdentityConverter()
+{
+    // Never freed, because it's required until the interpreter shuts down
+    static PyObject* s_pIdentity = NULL;
+    if (!s_pIdentity)
+        s_pIdentity = incref(eval("lambda x: x").ptr());
+
+    return object(handle<>(borrowed(s_pIdentity)));
+}
+
 // ============================================================================
 // CPointer class
 // ============================================================================
@@ -55,6 +75,14 @@ CPointer::CPointer(unsigned long ulAddr /* = 0 */)
     m_ulAddr = ulAddr;
 }
 
+inline bool UTIL_IsOverlapping(unsigned long ulFirst, unsigned long ulSecond, unsigned long ulNumBytes)
+{
+    if (ulFirst <= ulSecond)
+        return ulFirst + ulNumBytes > ulSecond;
+
+    return ulSecond + ulNumBytes > ulFirst;
+}
+
 int CPointer::Compare(object oOther, unsigned long ulNum)
 {
     unsigned long ulOther = ExtractPyPtr(oOther);
@@ -66,14 +94,10 @@ int CPointer::Compare(object oOther, unsigned long ulNum)
 
 bool CPointer::IsOverlapping(object oOther, unsigned long ulNumBytes)
 {
-    unsigned long ulOther = ExtractPyPtr(oOther);
-	if (m_ulAddr <= ulOther)
-		return m_ulAddr + ulNumBytes > ulOther;
-        
-	return ulOther + ulNumBytes > m_ulAddr;
+    return UTIL_IsOverlapping(m_ulAddr, ExtractPyPtr(oOther), ulNumBytes);
 }
 
-CPointer* CPointer::SearchBytes(object oBytes, unsigned long ulNumBytes)
+object CPointer::SearchBytes(object oBytes, unsigned long ulNumBytes)
 {
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
@@ -99,11 +123,11 @@ CPointer* CPointer::SearchBytes(object oBytes, unsigned long ulNumBytes)
         }
 
         if (i == iByteLen)
-            return new CPointer((unsigned long) base);
+            return object(CPointer((unsigned long) base));
 
         base++;
     }
-    return NULL;
+    return object();
 }
 
 void CPointer::Copy(object oDest, unsigned long ulNumBytes)
@@ -112,7 +136,7 @@ void CPointer::Copy(object oDest, unsigned long ulNumBytes)
     if (!m_ulAddr || ulDest == 0)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "At least one pointer is NULL.")
 
-    if (IsOverlapping(oDest, ulNumBytes))
+    if (UTIL_IsOverlapping(m_ulAddr, ulDest, ulNumBytes))
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointers are overlapping!")
 
     memcpy((void *) ulDest, (void *) m_ulAddr, ulNumBytes);
@@ -153,12 +177,12 @@ void CPointer::SetStringArray(char* szText, int iOffset /* = 0 */, int iSize /*
     strcpy((char *) (m_ulAddr + iOffset), szText);
 }
 
-CPointer* CPointer::GetPtr(int iOffset /* = 0 */)
+CPointer CPointer::GetPtr(int iOffset /* = 0 */)
 {
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
 
-    return new CPointer(*(unsigned long *) (m_ulAddr + iOffset));
+    return CPointer(*(unsigned long *) (m_ulAddr + iOffset));
 }
 
 void CPointer::SetPtr(object oPtr, int iOffset /* = 0 */)
@@ -174,16 +198,16 @@ unsigned long CPointer::GetSize()
     return UTIL_GetSize((void *) m_ulAddr);
 }
 
-CPointer* CPointer::GetVirtualFunc(int iIndex)
+CPointer CPointer::GetVirtualFunc(int iIndex)
 {
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
 
     void** vtable = *(void ***) m_ulAddr;
     if (!vtable)
-        return new CPointer();
+        return CPointer();
 
-    return new CPointer((unsigned long) vtable[iIndex]);
+    return CPointer((unsigned long) vtable[iIndex]);
 }
 
 void CPointer::Realloc(unsigned long ulSize)
@@ -204,7 +228,7 @@ CFunction* CPointer::MakeFunction(Convention_t eConv, char* szParams, PyObject*
 
 CFunction* CPointer::MakeVirtualFunction(int iIndex, Convention_t eConv, char* szParams, PyObject* pConverter /* = NULL */)
 {
-    return GetVirtualFunc(iIndex)->MakeFunction(eConv, szParams, pConverter);
+    return GetVirtualFunc(iIndex).MakeFunction(eConv, szParams, pConverter);
 }
 
 CPtrArray CPointer::MakePtrArray(unsigned int iTypeSize, int iLength /* = -1 */, PyObject* pConverter /* = NULL */)
@@ -220,7 +244,7 @@ CPtrArray::CPtrArray(unsigned long ulAddr, unsigned int iTypeSize, int iLength /
 : CArray<unsigned long>::CArray(ulAddr, iLength)
 {
     m_iTypeSize = iTypeSize;
-    m_oConverter = pConverter ? object(handle<>(borrowed(pConverter))) : eval("lambda x: x");
+    m_oConverter = pConverter ? object(handle<>(borrowed(pConverter))) : GetIdentityConverter();
 }
 
 object CPtrArray::GetItem(unsigned int iIndex)
@@ -238,12 +262,307 @@ void CPtrArray::SetItem(unsigned int iIndex, object oValue)
 // ============================================================================
 // CFunction class
 // ============================================================================
-CFunction::CFunction(unsigned long ulAddr, Convention_t eConv, char* szParams, PyObject* pConverter /* = NULL */)
+// Argument handlers. Every parameter character is compiled into one of them.
+#define ARG_HANDLER(name, type, push_function) \
+    bool name(DCCallVM* pVM, PyObject* pArg) \
+    { \
+        type value; \
+        if (!FromPyObject<type>(pArg, value)) \
+            return false; \
+        push_function(pVM, value); \
+        return true; \
+    }
+
+ARG_HANDLER(ArgBool, bool, dcArgBool)
+ARG_HANDLER(ArgChar, char, dcArgChar)
+ARG_HANDLER(ArgUChar, unsigned char, dcArgChar)
+ARG_HANDLER(ArgShort, short, dcArgShort)
+ARG_HANDLER(ArgUShort, unsigned short, dcArgShort)
+ARG_HANDLER(ArgInt, int, dcArgInt)
+ARG_HANDLER(ArgUInt, unsigned int, dcArgInt)
+ARG_HANDLER(ArgLong, long, dcArgLong)
+ARG_HANDLER(ArgULong, unsigned long, dcArgLong)
+ARG_HANDLER(ArgLongLong, long long, dcArgLongLong)
+ARG_HANDLER(ArgULongLong, unsigned long long, dcArgLongLong)
+ARG_HANDLER(ArgFloat, float, dcArgFloat)
+ARG_HANDLER(ArgDouble, double, dcArgDouble)
+
+bool ArgPointer(DCCallVM* pVM, PyObject* pArg)
+{
+    unsigned long ulAddr;
+    if (!TryExtractPyPtr(pArg, ulAddr))
+    {
+        PyErr_SetString(PyExc_TypeError, "Expected an address or a Pointer object.");
+        return false;
+    }
+    dcArgPointer(pVM, ulAddr);
+    return true;
+}
+
+bool ArgString(DCCallVM* pVM, PyObject* pArg)
+{
+    const char* szValue;
+    if (!FromPyObject<const char *>(pArg, szValue))
+        return false;
+
+    dcArgPointer(pVM, (DCpointer) szValue);
+    return true;
+}
+
+ArgHandler_t GetArgHandler(char ch)
+{
+    switch(ch)
+    {
+        case DC_SIGCHAR_BOOL:      return &ArgBool;
+        case DC_SIGCHAR_CHAR:      return &ArgChar;
+        case DC_SIGCHAR_UCHAR:     return &ArgUChar;
+        case DC_SIGCHAR_SHORT:     return &ArgShort;
+        case DC_SIGCHAR_USHORT:    return &ArgUShort;
+        case DC_SIGCHAR_INT:       return &ArgInt;
+        case DC_SIGCHAR_UINT:      return &ArgUInt;
+        case DC_SIGCHAR_LONG:      return &ArgLong;
+        case DC_SIGCHAR_ULONG:     return &ArgULong;
+        case DC_SIGCHAR_LONGLONG:  return &ArgLongLong;
+        case DC_SIGCHAR_ULONGLONG: return &ArgULongLong;
+        case DC_SIGCHAR_FLOAT:     return &ArgFloat;
+        case DC_SIGCHAR_DOUBLE:    return &ArgDouble;
+        case DC_SIGCHAR_POINTER:   return &ArgPointer;
+        case DC_SIGCHAR_STRING:    return &ArgString;
+    }
+    return NULL;
+}
+
+// Return handlers. The return type character is compiled into one of them.
+#define RETURN_HANDLER(name, type, call_function) \
+    object name(DCCallVM* pVM, DCpointer pFunc, object& oConverter, bool bReleaseGIL) \
+    { \
+        type value; \
+        NATIVE_CALL(bReleaseGIL, value = (type) call_function(pVM, pFunc)) \
+        return object(handle<>(ToPyObject<type>(value))); \
+    }
+
+RETURN_HANDLER(ReturnBool, bool, dcCallBool)
+RETURN_HANDLER(ReturnChar, char, dcCallChar)
+RETURN_HANDLER(ReturnUChar, unsigned char, dcCallChar)
+RETURN_HANDLER(ReturnShort, short, dcCallShort)
+RETURN_HANDLER(ReturnUShort, unsigned short, dcCallShort)
+RETURN_HANDLER(ReturnInt, int, dcCallInt)
+RETURN_HANDLER(ReturnUInt, unsigned int, dcCallInt)
+RETURN_HANDLER(ReturnLong, long, dcCallLong)
+RETURN_HANDLER(ReturnULong, unsigned long, dcCallLong)
+RETURN_HANDLER(ReturnLongLong, long long, dcCallLongLong)
+RETURN_HANDLER(ReturnULongLong, unsigned long long, dcCallLongLong)
+RETURN_HANDLER(ReturnFloat, float, dcCallFloat)
+RETURN_HANDLER(ReturnDouble, double, dcCallDouble)
+RETURN_HANDLER(ReturnString, const char *, dcCallPointer)
+
+object ReturnVoid(DCCallVM* pVM, DCpointer pFunc, object& oConverter, bool bReleaseGIL)
+{
+    NATIVE_CALL(bReleaseGIL, dcCallVoid(pVM, pFunc))
+    return object();
+}
+
+object ReturnPointer(DCCallVM* pVM, DCpointer pFunc, object& oConverter, bool bReleaseGIL)
+{
+    unsigned long ulAddr;
+    NATIVE_CALL(bReleaseGIL, ulAddr = dcCallPointer(pVM, pFunc))
+    return oConverter(CPointer(ulAddr));
+}
+
+ReturnHandler_t GetReturnHandler(char ch)
+{
+    switch(ch)
+    {
+        case DC_SIGCHAR_VOID:      return &ReturnVoid;
+        case DC_SIGCHAR_BOOL:      return &ReturnBool;
+        case DC_SIGCHAR_CHAR:      return &ReturnChar;
+        case DC_SIGCHAR_UCHAR:     return &ReturnUChar;
+        case DC_SIGCHAR_SHORT:     return &ReturnShort;
+        case DC_SIGCHAR_USHORT:    return &ReturnUShort;
+        case DC_SIGCHAR_INT:       return &ReturnInt;
+        case DC_SIGCHAR_UINT:      return &ReturnUInt;
+        case DC_SIGCHAR_LONG:      return &ReturnLong;
+        case DC_SIGCHAR_ULONG:     return &ReturnULong;
+        case DC_SIGCHAR_LONGLONG:  return &ReturnLongLong;
+        case DC_SIGCHAR_ULONGLONG: return &ReturnULongLong;
+        case DC_SIGCHAR_FLOAT:     return &ReturnFloat;
+        case DC_SIGCHAR_DOUBLE:    return &ReturnDouble;
+        case DC_SIGCHAR_POINTER:   return &ReturnPointer;
+        case DC_SIGCHAR_STRING:    return &ReturnString;
+    }
+    return NULL;
+}
+
+// Pushes raw native values and calls functions for CFunction::Map()
+inline void PushArg(DCCallVM* pVM, bool value)               { dcArgBool(pVM, value); }
+inline void PushArg(DCCallVM* pVM, char value)               { dcArgChar(pVM, value); }
+inline void PushArg(DCCallVM* pVM, unsigned char value)      { dcArgChar(pVM, value); }
+inline void PushArg(DCCallVM* pVM, short value)              { dcArgShort(pVM, value); }
+inline void PushArg(DCCallVM* pVM, unsigned short value)     { dcArgShort(pVM, value); }
+inline void PushArg(DCCallVM* pVM, int value)                { dcArgInt(pVM, value); }
+inline void PushArg(DCCallVM* pVM, unsigned int value)       { dcArgInt(pVM, value); }
+inline void PushArg(DCCallVM* pVM, long value)               { dcArgLong(pVM, value); }
+inline void PushArg(DCCallVM* pVM, unsigned long value)      { dcArgLong(pVM, value); }
+inline void PushArg(DCCallVM* pVM, long long value)          { dcArgLongLong(pVM, value); }
+inline void PushArg(DCCallVM* pVM, unsigned long long value) { dcArgLongLong(pVM, value); }
+inline void PushArg(DCCallVM* pVM, float value)              { dcArgFloat(pVM, value); }
+inline void PushArg(DCCallVM* pVM, double value)             { dcArgDouble(pVM, value); }
+
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, bool& value)               { value = dcCallBool(pVM, pFunc) != 0; }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, char& value)               { value = dcCallChar(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, unsigned char& value)      { value = dcCallChar(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, short& value)              { value = dcCallShort(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, unsigned short& value)     { value = dcCallShort(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, int& value)                { value = dcCallInt(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, unsigned int& value)       { value = dcCallInt(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, long& value)               { value = dcCallLong(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, unsigned long& value)      { value = dcCallPointer(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, long long& value)          { value = dcCallLongLong(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, unsigned long long& value) { value = dcCallLongLong(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, float& value)              { value = dcCallFloat(pVM, pFunc); }
+inline void CallVM(DCCallVM* pVM, DCpointer pFunc, double& value)             { value = dcCallDouble(pVM, pFunc); }
+
+typedef void (*RawArgPusher_t)(DCCallVM* pVM, const void* pValue);
+typedef bool (*RawCaller_t)(DCCallVM* pVM, DCpointer pFunc, void* pResult);
+
+template<class T>
+void PushRawArg(DCCallVM* pVM, const void* pValue)
+{
+    PushArg(pVM, *(const T *) pValue);
+}
+
+// Returns true if the result is not zero
+template<class T>
+bool CallRaw(DCCallVM* pVM, DCpointer pFunc, void* pResult)
+{
+    T value;
+    CallVM(pVM, pFunc, value);
+    *(T *) pResult = value;
+    return value != T();
+}
+
+bool CallRawVoid(DCCallVM* pVM, DCpointer pFunc, void* pResult)
+{
+    dcCallVoid(pVM, pFunc);
+    return false;
+}
+
+// Returns the native type of a parameter character. Strings and void are not
+// native types.
+NativeType_t GetSigCharNativeType(char ch)
+{
+    switch(ch)
+    {
+        case DC_SIGCHAR_BOOL:      return NATIVE_BOOL;
+        case DC_SIGCHAR_CHAR:      return NATIVE_CHAR;
+        case DC_SIGCHAR_UCHAR:     return NATIVE_UCHAR;
+        case DC_SIGCHAR_SHORT:     return NATIVE_SHORT;
+        case DC_SIGCHAR_USHORT:    return NATIVE_USHORT;
+        case DC_SIGCHAR_INT:       return NATIVE_INT;
+        case DC_SIGCHAR_UINT:      return NATIVE_UINT;
+        case DC_SIGCHAR_LONG:      return NATIVE_LONG;
+        case DC_SIGCHAR_ULONG:     return NATIVE_ULONG;
+        case DC_SIGCHAR_LONGLONG:  return NATIVE_LONG_LONG;
+        case DC_SIGCHAR_ULONGLONG: return NATIVE_ULONG_LONG;
+        case DC_SIGCHAR_FLOAT:     return NATIVE_FLOAT;
+        case DC_SIGCHAR_DOUBLE:    return NATIVE_DOUBLE;
+        case DC_SIGCHAR_POINTER:   return NATIVE_PTR;
+    }
+    return NATIVE_INVALID;
+}
+
+template<class T>
+void GetRawArgPusher(RawArgPusher_t& pPusher)
+{
+    pPusher = &PushRawArg<T>;
+}
+
+template<class T>
+void GetRawCaller(RawCaller_t& pCaller)
+{
+    pCaller = &CallRaw<T>;
+}
+
+struct MapColumn_t
+{
+    const unsigned char*       m_pValues;
+    int                        m_iStride;
+    RawArgPusher_t             m_pPusher;
+    std::vector<unsigned char> m_vecValues;
+};
+
+// Sets the mode of the call VM. dcMode() is only called if the mode actually
+// changes.
+inline void SetCallVMMode(DCCallVM* pVM, int iMode)
+{
+    if (iMode != g_iCallVMMode)
+    {
+        dcMode(pVM, iMode);
+        g_iCallVMMode = iMode;
+    }
+}
+
+// Calls the function once per row of the columns and stores the results.
+// If <pIndices> is not NULL, only non-zero results are stored and their row
+// is added to <pIndices>. Returns the number of stored results.
+size_t CallMapped(DCCallVM* pVM, int iMode, DCpointer pFunc, std::vector<MapColumn_t>& vecColumns, int iCount,
+    RawCaller_t pCaller, int iSize, unsigned char* pResults, std::vector<unsigned long>* pIndices)
+{
+    size_t iResults = 0;
+    for (int i=0; i < iCount; i++)
+    {
+        // A hook or callback of the previous call might have called another
+        // function with a different convention on this thread
+        SetCallVMMode(pVM, iMode);
+        dcReset(pVM);
+        for (size_t j=0; j < vecColumns.size(); j++)
+            vecColumns[j].m_pPusher(pVM, vecColumns[j].m_pValues + i * vecColumns[j].m_iStride);
+
+        bool bNonZero = pCaller(pVM, pFunc, pResults + iResults * iSize);
+        if (!pIndices)
+            iResults++;
+        else if (bNonZero)
+        {
+            pIndices->push_back(i);
+            iResults++;
+        }
+    }
+    return iResults;
+}
+
+DCCallVM* GetCallVM()
+{
+    if (!g_pCallVM)
+        g_pCallVM = dcNewCallVM(4096);
+
+    return g_pCallVM;
+}
+
+// Resets the call VM of the current thread and sets its mode. dcMode() is
+// only called if the mode actually changes.
+inline DCCallVM* PrepareCallVM(Convention_t eConv)
+{
+    DCCallVM* pVM = GetCallVM();
+    dcReset(pVM);
+    SetCallVMMode(pVM, GetDynCallConvention(eConv));
+    return pVM;
+}
+
+CFunction::CFunction(unsigned long ulAddr, Convention_t eConv, char* szParams, PyObject* pConverter /* = NULL */,
+    bool bReleaseGIL /* = false */)
 {
     m_ulAddr = ulAddr;
     m_eConv = eConv;
-    m_oConverter = pConverter ? object(handle<>(borrowed(pConverter))) : eval("lambda x: x");
+    m_oConverter = pConverter && pConverter != Py_None ? object(handle<>(borrowed(pConverter))) : GetIdentityConverter();
+    m_pStub = NULL;
+    m_bReleaseGIL = bReleaseGIL;
+
+    m_ulTrampoline = 0;
+    m_ulTrampolineTarget = 0;
+    m_iHookGeneration = 0;
+    m_pTrampolineStub = NULL;
 
+    m_Stats.Reset();
     SetParams(szParams);
 }
 
@@ -252,69 +571,117 @@ object CFunction::__call__(object args)
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
 
-    dcReset(g_pCallVM);
-    dcMode(g_pCallVM, GetDynCallConvention(m_eConv));
-    char* ptr = m_szParams;
-    int pos = 0;
-    char ch;
-    while ((ch = *ptr) != '\0' && ch != ')')
-    {
-        if (ch == DC_SIGCHAR_VOID)
-        {
-            ptr++;
-            break;
-        }
+    // The stub is only valid as long as the address and the convention don't
+    // change
+    bool bStubValid = m_pStub && m_pStub->m_ulAddr == m_ulAddr && m_pStub->m_eConv == m_eConv;
+    return Call(m_ulAddr, bStubValid ? m_pStub : NULL, args);
+}
 
-        object arg = args[pos];
-        switch(ch)
-        {
-            case DC_SIGCHAR_BOOL:      dcArgBool(g_pCallVM, extract<bool>(arg)); break;
-            case DC_SIGCHAR_CHAR:      dcArgChar(g_pCallVM, extract<char>(arg)); break;
-            case DC_SIGCHAR_UCHAR:     dcArgChar(g_pCallVM, extract<unsigned char>(arg)); break;
-            case DC_SIGCHAR_SHORT:     dcArgShort(g_pCallVM, extract<short>(arg)); break;
-            case DC_SIGCHAR_USHORT:    dcArgShort(g_pCallVM, extract<unsigned short>(arg)); break;
-            case DC_SIGCHAR_INT:       dcArgInt(g_pCallVM, extract<int>(arg)); break;
-            case DC_SIGCHAR_UINT:      dcArgInt(g_pCallVM, extract<unsigned int>(arg)); break;
-            case DC_SIGCHAR_LONG:      dcArgLong(g_pCallVM, extract<long>(arg)); break;
-            case DC_SIGCHAR_ULONG:     dcArgLong(g_pCallVM, extract<unsigned long>(arg)); break;
-            case DC_SIGCHAR_LONGLONG:  dcArgLongLong(g_pCallVM, extract<long long>(arg)); break;
-            case DC_SIGCHAR_ULONGLONG: dcArgLongLong(g_pCallVM, extract<unsigned long long>(arg)); break;
-            case DC_SIGCHAR_FLOAT:     dcArgFloat(g_pCallVM, extract<float>(arg)); break;
-            case DC_SIGCHAR_DOUBLE:    dcArgDouble(g_pCallVM, extract<double>(arg)); break;
-            case DC_SIGCHAR_POINTER:   dcArgPointer(g_pCallVM, ExtractPyPtr(arg)); break;
-            case DC_SIGCHAR_STRING:    dcArgPointer(g_pCallVM, (unsigned long) (void *) extract<char *>(arg)); break;
-            default: BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Unknown parameter type.")
-        }
-        pos++; ptr++;
+object CFunction::Call(unsigned long ulAddr, CallStub_t* pStub, object args)
+{
+    if (!g_bProfileCalls)
+        return Invoke(ulAddr, pStub, args);
+
+    unsigned long long ullStart = ReadTimestamp();
+    object result = Invoke(ulAddr, pStub, args);
+    m_Stats.AddSample(ReadTimestamp() - ullStart);
+    return result;
+}
+
+object CFunction::Invoke(unsigned long ulAddr, CallStub_t* pStub, object args)
+{
+    handle<> hArgs(PySequence_Fast(args.ptr(), "Arguments must be a sequence."));
+    if (PySequence_Fast_GET_SIZE(hArgs.get()) != (Py_ssize_t) m_vecArgHandlers.size())
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "String parameter count does not equal with length of tuple.")
+
+    PyObject** ppArgs = PySequence_Fast_ITEMS(hArgs.get());
+
+    if (pStub)
+        return CallStub(pStub, ppArgs, m_oConverter, m_bReleaseGIL);
+
+    DCCallVM* pVM = PrepareCallVM(m_eConv);
+    for (size_t i=0; i < m_vecArgHandlers.size(); i++)
+    {
+        if (!m_vecArgHandlers[i](pVM, ppArgs[i]))
+            throw_error_already_set();
     }
 
-    if (pos != len(args))
+    return m_pReturnHandler(pVM, ulAddr, m_oConverter, m_bReleaseGIL);
+}
+
+object CFunction::Map(tuple args, bool bNonZero /* = false */)
+{
+    if (!m_ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
+
+    if (len(args) != m_vecArgHandlers.size())
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "String parameter count does not equal with length of tuple.")
 
-    if (ch == '\0')
-        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "String parameter has no return type.")
+    const char* ptr = m_szParams.c_str();
+    if (*ptr == DC_SIGCHAR_VOID)
+        ptr++;
 
-    switch(*++ptr)
+    // Convert all arguments into native values
+    std::vector<MapColumn_t> vecColumns(m_vecArgHandlers.size());
+    int iCount = -1;
+    for (size_t i=0; i < vecColumns.size(); i++, ptr++)
     {
-        case DC_SIGCHAR_VOID: dcCallVoid(g_pCallVM, m_ulAddr); break;
-        case DC_SIGCHAR_BOOL:      return object(dcCallBool(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_CHAR:      return object(dcCallChar(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_UCHAR:     return object((unsigned char) dcCallChar(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_SHORT:     return object(dcCallShort(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_USHORT:    return object((unsigned short) dcCallShort(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_INT:       return object(dcCallInt(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_UINT:      return object((unsigned int) dcCallInt(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_LONG:      return object(dcCallLong(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_ULONG:     return object((unsigned long) dcCallLong(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_LONGLONG:  return object(dcCallLongLong(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_ULONGLONG: return object((unsigned long long) dcCallLongLong(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_FLOAT:     return object(dcCallFloat(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_DOUBLE:    return object(dcCallDouble(g_pCallVM, m_ulAddr));
-        case DC_SIGCHAR_POINTER:   return m_oConverter(CPointer(dcCallPointer(g_pCallVM, m_ulAddr)));
-        case DC_SIGCHAR_STRING:    return object((const char *) dcCallPointer(g_pCallVM, m_ulAddr));
-        default: BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Unknown return type.")
+        NativeType_t eType = GetSigCharNativeType(*ptr);
+        if (eType == NATIVE_INVALID)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Parameter type is not supported.")
+
+        MapColumn_t& column = vecColumns[i];
+        NATIVE_TYPE_DISPATCH(eType, GetRawArgPusher, column.m_pPusher)
+
+        const void* pValues;
+        int iLength = ExtractValues(args[i], eType, column.m_vecValues, pValues);
+        column.m_pValues = (const unsigned char *) pValues;
+        column.m_iStride = iLength == -1 ? 0 : GetNativeTypeSize(eType);
+        if (iLength == -1)
+            continue;
+
+        if (iCount != -1 && iLength != iCount)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "All arrays must have the same length.")
+
+        iCount = iLength;
     }
-    return object();
+
+    if (iCount == -1)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "At least one argument must be an array.")
+
+    // Skip the closing bracket
+    char cReturn = *++ptr;
+    NativeType_t eReturnType = GetSigCharNativeType(cReturn);
+    RawCaller_t pCaller = &CallRawVoid;
+    int iSize = 0;
+    if (cReturn != DC_SIGCHAR_VOID)
+    {
+        if (eReturnType == NATIVE_INVALID)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Return type is not supported.")
+
+        NATIVE_TYPE_DISPATCH(eReturnType, GetRawCaller, pCaller)
+        iSize = GetNativeTypeSize(eReturnType);
+    }
+
+    std::vector<unsigned char> vecResults(iCount * iSize + 1);
+    std::vector<unsigned long> vecIndices;
+    if (bNonZero)
+        vecIndices.reserve(iCount);
+
+    DCCallVM* pVM = GetCallVM();
+    size_t iResults;
+    NATIVE_CALL(m_bReleaseGIL, iResults = CallMapped(pVM, GetDynCallConvention(m_eConv), m_ulAddr, vecColumns, iCount, pCaller, iSize,
+        &vecResults[0], bNonZero ? &vecIndices : NULL))
+
+    if (cReturn == DC_SIGCHAR_VOID)
+        return object();
+
+    object oResults = CreatePyArray(eReturnType, &vecResults[0], iResults);
+    if (!bNonZero)
+        return oResults;
+
+    object oIndices = CreatePyArray(NATIVE_ULONG, vecIndices.empty() ? NULL : &vecIndices[0], vecIndices.size());
+    return make_tuple(oIndices, oResults);
 }
 
 object CFunction::CallTrampoline(object args)
@@ -322,21 +689,53 @@ object CFunction::CallTrampoline(object args)
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
 
-    CHook* pHook = g_pHookMngr->FindHook((void *) m_ulAddr);
-    if (!pHook)
-        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function was not hooked.")
+    // The cached trampoline is outdated if the address changed or if a hook
+    // was added or removed since we looked it up
+    if (m_ulTrampolineTarget != m_ulAddr || m_iHookGeneration != g_pHookMngr->m_iGeneration)
+    {
+        CHook* pHook = g_pHookMngr->FindHook((void *) m_ulAddr);
+        if (!pHook)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function was not hooked.")
+
+        m_ulTrampoline = (unsigned long) pHook->m_pTrampoline;
+        m_ulTrampolineTarget = m_ulAddr;
+        m_iHookGeneration = g_pHookMngr->m_iGeneration;
+        m_pTrampolineStub = NULL;
+    }
+
+    // Compiled functions also use a stub to call the trampoline
+    CallStub_t* pStub = NULL;
+    if (m_pStub && m_pStub->m_ulAddr == m_ulAddr && m_pStub->m_eConv == m_eConv)
+    {
+        if (!m_pTrampolineStub || m_pTrampolineStub->m_eConv != m_eConv)
+            m_pTrampolineStub = GetCallStub(m_ulTrampoline, m_eConv, m_szParams.c_str());
 
-    return CFunction((unsigned long) pHook->m_pTrampoline, m_eConv, m_szParams, m_oConverter.ptr()).__call__(args);
+        pStub = m_pTrampolineStub;
+    }
+    return Call(m_ulTrampoline, pStub, args);
+}
+
+void CFunction::Compile()
+{
+    m_pStub = GetCallStub(m_ulAddr, m_eConv, m_szParams.c_str());
 }
 
-void CFunction::Hook(DynamicHooks::HookType_t eType, PyObject* pCallable)
+void CFunction::Hook(DynamicHooks::HookType_t eType, PyObject* pCallable, object oPredicate)
 {
     if (!m_ulAddr)
         BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
 
-    CHook* pHook = g_pHookMngr->HookFunction((void *) m_ulAddr, m_eConv, m_szParams);
+    // Validate the predicate first, so an invalid one doesn't leave a hook
+    // behind
+    if (!oPredicate.is_none())
+    {
+        CHookPredicate* pPredicate = extract<CHookPredicate*>(oPredicate);
+        pPredicate->Validate(m_szParams.c_str());
+    }
+
+    CHook* pHook = g_pHookMngr->HookFunction((void *) m_ulAddr, m_eConv, (char *) m_szParams.c_str());
     pHook->AddCallback(eType, (void *) &binutils_HookHandler);
-    g_mapCallbacks[pHook][eType].push_back(pCallable);
+    AddHookCallback(pHook, eType, pCallable, oPredicate);
 }
 
 void CFunction::Unhook(DynamicHooks::HookType_t eType, PyObject* pCallable)
@@ -348,17 +747,41 @@ void CFunction::Unhook(DynamicHooks::HookType_t eType, PyObject* pCallable)
     if (!pHook)
         return;
 
-    g_mapCallbacks[pHook][eType].remove(pCallable);
+    // Without any callbacks the bridge doesn't need to enter the hook
+    // handler for this hook type anymore
+    if (!RemoveHookCallback(pHook, eType, pCallable))
+        pHook->RemoveCallback(eType, (void *) &binutils_HookHandler);
+}
+
+void CFunction::AddNativeHook(DynamicHooks::HookType_t eType, object oCallback)
+{
+    if (!m_ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
+
+    CHook* pHook = g_pHookMngr->HookFunction((void *) m_ulAddr, m_eConv, (char *) m_szParams.c_str());
+    AddNativeHookCallback(pHook, eType, oCallback);
+}
+
+void CFunction::RemoveNativeHook(DynamicHooks::HookType_t eType, object oCallback)
+{
+    if (!m_ulAddr)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Function pointer is NULL.")
+
+    CHook* pHook = g_pHookMngr->FindHook((void *) m_ulAddr);
+    if (!pHook)
+        return;
+
+    RemoveNativeHookCallback(pHook, eType, oCallback);
 }
 
-void CFunction::AddPreHook(PyObject* pCallable)
+void CFunction::AddPreHook(PyObject* pCallable, object oPredicate)
 {
-    Hook(HOOKTYPE_PRE, pCallable);
+    Hook(HOOKTYPE_PRE, pCallable, oPredicate);
 }
 
-void CFunction::AddPostHook(PyObject* pCallable)
+void CFunction::AddPostHook(PyObject* pCallable, object oPredicate)
 {
-    Hook(HOOKTYPE_POST, pCallable);
+    Hook(HOOKTYPE_POST, pCallable, oPredicate);
 }
 
 void CFunction::RemovePreHook(PyObject* pCallable)
@@ -373,12 +796,62 @@ void CFunction::RemovePostHook(PyObject* pCallable)
 
 void CFunction::SetParams(char* szParams)
 {
-    strcpy(m_szParams, szParams);
+    std::vector<ArgHandler_t> vecArgHandlers;
+    char* ptr = szParams;
+
+    // A leading "v" means that the function doesn't take any arguments
+    if (*ptr == DC_SIGCHAR_VOID)
+        ptr++;
+
+    for (; *ptr != '\0' && *ptr != ')'; ptr++)
+    {
+        ArgHandler_t pHandler = GetArgHandler(*ptr);
+        if (!pHandler)
+            BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Unknown parameter type.")
+
+        vecArgHandlers.push_back(pHandler);
+    }
+
+    if (*ptr == '\0')
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "String parameter has no return type.")
+
+    ReturnHandler_t pReturnHandler = GetReturnHandler(*++ptr);
+    if (!pReturnHandler)
+        BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Unknown return type.")
+
+    // Only apply the new parameters if they are valid
+    m_szParams = szParams;
+    m_vecArgHandlers.swap(vecArgHandlers);
+    m_pReturnHandler = pReturnHandler;
+
+    // The stubs were generated for the old parameters
+    m_pStub = NULL;
+    m_pTrampolineStub = NULL;
 }
 
 const char* CFunction::GetParams()
 {
-    return (const char *) m_szParams;
+    return m_szParams.c_str();
+}
+
+dict CFunction::GetStats()
+{
+    // Remove empty buckets at the end
+    int iBuckets = CALL_STATS_BUCKETS;
+    while (iBuckets > 0 && !m_Stats.m_ullBuckets[iBuckets - 1])
+        iBuckets--;
+
+    list histogram;
+    for (int i=0; i < iBuckets; i++)
+        histogram.append(m_Stats.m_ullBuckets[i]);
+
+    dict stats;
+    stats["count"] = m_Stats.m_ullCount;
+    stats["total"] = m_Stats.m_ullTotal;
+    stats["min"] = m_Stats.m_ullMin;
+    stats["max"] = m_Stats.m_ullMax;
+    stats["histogram"] = histogram;
+    return stats;
 }
 
 
@@ -387,5 +860,15 @@ const char* CFunction::GetParams()
 // ============================================================================
 int GetError()
 {
-    return dcGetError(g_pCallVM);
+    return dcGetError(GetCallVM());
+}
+
+void SetProfiling(bool bEnabled)
+{
+    g_bProfileCalls = bEnabled;
+}
+
+bool IsProfiling()
+{
+    return g_bProfileCalls;
 }
\ No newline at end of file
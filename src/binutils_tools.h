@@ -24,7 +24,17 @@
 // >> INCLUDES
 // ============================================================================
 #include <malloc.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
 #include "binutils_macros.h"
+#include "binutils_descriptors.h"
 #include "dyncall.h"
 
 #include "DynamicHooks.h"
@@ -34,12 +44,6 @@ using namespace DynamicHooks;
 using namespace boost::python;
 
 
-// ============================================================================
-// >> DEINITIONS
-// ============================================================================
-#define MAX_PARAMETER_STR 32
-
-
 // ============================================================================
 // >> Convention_t enum
 // ============================================================================
@@ -130,20 +134,20 @@ public:
     const char *        GetStringArray(int iOffset = 0);
     void                SetStringArray(char* szText, int iOffset = 0, int iSize = -1);
 
-    CPointer*           GetPtr(int iOffset = 0);
+    CPointer            GetPtr(int iOffset = 0);
     void                SetPtr(object oPtr, int iOffset = 0);
 
     unsigned long       GetSize();
     unsigned long       GetAddress() { return m_ulAddr; }
 
     bool                IsOverlapping(object oOther, unsigned long ulNumBytes);
-    CPointer*           SearchBytes(object oBytes, unsigned long ulNumBytes);
+    object              SearchBytes(object oBytes, unsigned long ulNumBytes);
 
     int                 Compare(object oOther, unsigned long ulNum);
     void                Copy(object oDest, unsigned long ulNumBytes);
     void                Move(object oDest, unsigned long ulNumBytes);
 
-    CPointer*           GetVirtualFunc(int iIndex);
+    CPointer            GetVirtualFunc(int iIndex);
 
     void                Realloc(unsigned long ulSize);
     void                Dealloc();
@@ -160,31 +164,133 @@ public:
 };
 
 
+// Pushes an argument to the call VM. Returns false and sets a Python error if
+// the argument couldn't be converted.
+typedef bool (*ArgHandler_t)(DCCallVM* pVM, PyObject* pArg);
+
+// Calls the function and converts its return value.
+// The GIL is released during the call if <bReleaseGIL> is true.
+typedef object (*ReturnHandler_t)(DCCallVM* pVM, DCpointer pFunc, object& oConverter, bool bReleaseGIL);
+
+struct CallStub_t;
+
+// Number of histogram buckets. Bucket i counts the calls that took between
+// 2^i and 2^(i+1) - 1 timestamp ticks.
+#define CALL_STATS_BUCKETS 48
+
+// Returns a cheap, monotonic timestamp. On x86 these are CPU cycles.
+inline unsigned long long ReadTimestamp()
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    return __builtin_ia32_rdtsc();
+#elif defined(_MSC_VER)
+    return __rdtsc();
+#else
+    return (unsigned long long) clock();
+#endif
+}
+
+// Call statistics of a function. Only recorded if profiling is enabled.
+struct CallStats_t
+{
+    unsigned long long m_ullCount;
+    unsigned long long m_ullTotal;
+    unsigned long long m_ullMin;
+    unsigned long long m_ullMax;
+    unsigned long long m_ullBuckets[CALL_STATS_BUCKETS];
+
+    void Reset()
+    {
+        memset(this, 0, sizeof(CallStats_t));
+    }
+
+    void AddSample(unsigned long long ullTicks)
+    {
+        if (!m_ullCount || ullTicks < m_ullMin)
+            m_ullMin = ullTicks;
+
+        if (ullTicks > m_ullMax)
+            m_ullMax = ullTicks;
+
+        m_ullCount++;
+        m_ullTotal += ullTicks;
+
+        int iBucket = 0;
+        while (ullTicks >>= 1)
+            iBucket++;
+
+        m_ullBuckets[iBucket < CALL_STATS_BUCKETS ? iBucket : CALL_STATS_BUCKETS - 1]++;
+    }
+};
+
+// True if calls of all functions should be profiled
+extern bool g_bProfileCalls;
+
 // CFunction class
 class CFunction: public CPointer
 {
 public:
-    CFunction(unsigned long ulAddr, Convention_t eConv, char* szParams, PyObject* pConverter = NULL);
+    CFunction(unsigned long ulAddr, Convention_t eConv, char* szParams, PyObject* pConverter = NULL, bool bReleaseGIL = false);
 
     object __call__(object args);
     object CallTrampoline(object args);
 
-    void Hook(HookType_t eType, PyObject* pCallable);
+    void Compile();
+    object Map(tuple args, bool bNonZero = false);
+
+    void Hook(HookType_t eType, PyObject* pCallable, object oPredicate = object());
     void Unhook(HookType_t eType, PyObject* pCallable);
 
-    void AddPreHook(PyObject* pCallable);
-    void AddPostHook(PyObject* pCallable);
+    void AddPreHook(PyObject* pCallable, object oPredicate = object());
+    void AddPostHook(PyObject* pCallable, object oPredicate = object());
 
     void RemovePreHook(PyObject* pCallable);
     void RemovePostHook(PyObject* pCallable);
 
+    void AddNativeHook(HookType_t eType, object oCallback);
+    void RemoveNativeHook(HookType_t eType, object oCallback);
+
+    void AddNativePreHook(object oCallback)     { AddNativeHook(HOOKTYPE_PRE, oCallback); }
+    void AddNativePostHook(object oCallback)    { AddNativeHook(HOOKTYPE_POST, oCallback); }
+
+    void RemoveNativePreHook(object oCallback)  { RemoveNativeHook(HOOKTYPE_PRE, oCallback); }
+    void RemoveNativePostHook(object oCallback) { RemoveNativeHook(HOOKTYPE_POST, oCallback); }
+
     void SetParams(char* szPrams);
     const char* GetParams();
 
+    dict GetStats();
+    void ResetStats() { m_Stats.Reset(); }
+
+private:
+    // Calls <ulAddr> with the signature of this function. The stub is used if
+    // it's not NULL. The call is recorded if profiling is enabled.
+    object Call(unsigned long ulAddr, CallStub_t* pStub, object args);
+    object Invoke(unsigned long ulAddr, CallStub_t* pStub, object args);
+
 public:
-    char         m_szParams[MAX_PARAMETER_STR];
+    std::string  m_szParams;
     Convention_t m_eConv;
     object       m_oConverter;
+
+    // The parameter string compiled by SetParams()
+    std::vector<ArgHandler_t> m_vecArgHandlers;
+    ReturnHandler_t           m_pReturnHandler;
+
+    // The stub created by Compile() or NULL
+    CallStub_t*               m_pStub;
+
+    // Release the GIL while the native function is running
+    bool                      m_bReleaseGIL;
+
+    // The trampoline of m_ulTrampolineTarget. It's looked up again if the
+    // hook manager's generation changes.
+    unsigned long             m_ulTrampoline;
+    unsigned long             m_ulTrampolineTarget;
+    unsigned int              m_iHookGeneration;
+    CallStub_t*               m_pTrampolineStub;
+
+    CallStats_t               m_Stats;
 };
 
 
@@ -239,28 +345,91 @@ public:
 // ============================================================================
 // >> FUNCTIONS
 // ============================================================================
+// Returns the call VM of the current thread. It's created on first use.
+DCCallVM* GetCallVM();
+
 int GetError();
 
-inline unsigned long ExtractPyPtr(object obj)
+void SetProfiling(bool bEnabled);
+bool IsProfiling();
+
+// Converts an integer or a Pointer instance (including subclasses) into an
+// address. Returns false if the object is neither of them. This never raises
+// or throws, so it's safe to use it on hot paths.
+inline bool TryExtractPyPtr(PyObject* pObj, unsigned long& ulAddr)
 {
-    // Try to get an unsigned long at first
-    try
+#if PYTHON_VERSION != 3
+    if (PyInt_Check(pObj))
+    {
+        long lValue = PyInt_AS_LONG(pObj);
+        if (lValue < 0)
+            return false;
+
+        ulAddr = (unsigned long) lValue;
+        return true;
+    }
+#endif
+
+    if (PyLong_Check(pObj))
+    {
+        unsigned long ulValue = PyLong_AsUnsignedLong(pObj);
+        if (ulValue == (unsigned long) -1 && PyErr_Occurred())
+        {
+            PyErr_Clear();
+            return false;
+        }
+
+        ulAddr = ulValue;
+        return true;
+    }
+
+    CPointer* pPtr = (CPointer *) converter::get_lvalue_from_python(pObj,
+        converter::registered<CPointer>::converters);
+
+    if (pPtr)
     {
-        return extract<unsigned long>(obj);
+        ulAddr = pPtr->m_ulAddr;
+        return true;
     }
-    catch(...)
+
+    PyObject* pFunction = GetBoundFunction(pObj);
+    if (pFunction)
+        return TryExtractPyPtr(pFunction, ulAddr);
+
+    // Lazy functions are resolved on first use. If that fails, the caller
+    // raises its usual TypeError.
+    if (!PyObject_HasAttrString(pObj, "resolve"))
+        return false;
+
+    PyObject* pResolved = PyObject_CallMethod(pObj, "resolve", NULL);
+    if (!pResolved)
     {
         PyErr_Clear();
+        return false;
     }
 
-    // If that fails, try to extract a CPointer representation
-    CPointer* pPtr = extract<CPointer *>(obj);
-    return pPtr->GetAddress();
+    bool bResult = pResolved != pObj && TryExtractPyPtr(pResolved, ulAddr);
+    Py_DECREF(pResolved);
+    return bResult;
+}
+
+inline unsigned long ExtractPyPtr(PyObject* pObj)
+{
+    unsigned long ulAddr;
+    if (!TryExtractPyPtr(pObj, ulAddr))
+        BOOST_RAISE_EXCEPTION(PyExc_TypeError, "Expected an address or a Pointer object.")
+
+    return ulAddr;
+}
+
+inline unsigned long ExtractPyPtr(object obj)
+{
+    return ExtractPyPtr(obj.ptr());
 }
 
-inline CPointer* Alloc(unsigned long ulSize)
+inline CPointer Alloc(unsigned long ulSize)
 {
-    return new CPointer((unsigned long) malloc(ulSize));
+    return CPointer((unsigned long) malloc(ulSize));
 }
 
 inline unsigned char* GetByteRepr(object obj)
@@ -0,0 +1,212 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include <string.h>
+#include <set>
+#include <vector>
+
+#include "binutils_traversal.h"
+#include "binutils_batch.h"
+#include "binutils_convert.h"
+#include "binutils_macros.h"
+#include "binutils_tools.h"
+
+
+// ============================================================================
+// >> HELPER FUNCTIONS
+// ============================================================================
+inline unsigned long ReadLink(unsigned long ulNode, int iOffset)
+{
+    return *(unsigned long *) (ulNode + iOffset);
+}
+
+inline bool IsLimitReached(size_t iCount, int iLimit)
+{
+    return iLimit >= 0 && iCount >= (size_t) iLimit;
+}
+
+/*
+    Walks the list and calls visitor(node) for every node. The visitor returns
+    false to stop the walk. Cycles are detected with Brent's algorithm, so a
+    corrupt list can't hang the server.
+*/
+template<class Visitor>
+void VisitList(unsigned long ulHead, int iNextOffset, int iLimit, Visitor& visitor)
+{
+    unsigned long ulNode = ulHead;
+    unsigned long ulCheckpoint = 0;
+    size_t iPower = 1;
+    size_t iSteps = 0;
+    size_t iCount = 0;
+
+    while (ulNode && !IsLimitReached(iCount, iLimit))
+    {
+        unsigned long ulNext = ReadLink(ulNode, iNextOffset);
+        PREFETCH(ulNext + iNextOffset);
+
+        if (!visitor(ulNode))
+            break;
+
+        iCount++;
+        if (ulNext == ulHead || ulNext == ulCheckpoint)
+            break;
+
+        // Move the checkpoint forward every 2^n steps
+        if (++iSteps == iPower)
+        {
+            ulCheckpoint = ulNext;
+            iPower <<= 1;
+            iSteps = 0;
+        }
+        ulNode = ulNext;
+    }
+}
+
+struct CollectNodes
+{
+    std::vector<unsigned long> m_vecNodes;
+
+    bool operator()(unsigned long ulNode)
+    {
+        m_vecNodes.push_back(ulNode);
+        return true;
+    }
+};
+
+struct CollectFields
+{
+    CollectFields(int iFieldOffset, int iSize, const unsigned char* pStop)
+    {
+        m_iFieldOffset = iFieldOffset;
+        m_iSize = iSize;
+        m_pStop = pStop;
+    }
+
+    bool operator()(unsigned long ulNode)
+    {
+        const unsigned char* pField = (const unsigned char *) (ulNode + m_iFieldOffset);
+        if (m_pStop && memcmp(pField, m_pStop, m_iSize) == 0)
+            return false;
+
+        m_vecData.insert(m_vecData.end(), pField, pField + m_iSize);
+        return true;
+    }
+
+    int                        m_iFieldOffset;
+    int                        m_iSize;
+    const unsigned char*       m_pStop;
+    std::vector<unsigned char> m_vecData;
+};
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+object WalkList(object oHead, int iNextOffset, int iLimit /* = -1 */)
+{
+    CollectNodes visitor;
+    VisitList(ExtractPyPtr(oHead), iNextOffset, iLimit, visitor);
+
+    std::vector<unsigned long>& vecNodes = visitor.m_vecNodes;
+    return CreatePyArray(NATIVE_PTR, vecNodes.empty() ? NULL : &vecNodes[0], vecNodes.size());
+}
+
+object WalkTree(object oRoot, int iLeftOffset, int iRightOffset, int iLimit /* = -1 */, object oNil /* = object() */)
+{
+    unsigned long ulNil = oNil.is_none() ? 0 : ExtractPyPtr(oNil);
+    unsigned long ulNode = ExtractPyPtr(oRoot);
+
+    // NULL always terminates a branch, so the sentinel node is mapped to it
+    if (ulNode == ulNil)
+        ulNode = 0;
+
+    std::vector<unsigned long> vecNodes;
+    std::vector<unsigned long> vecStack;
+
+    // Every node of a valid tree is pushed exactly once. A node that is
+    // pushed again is part of a cycle, which would never end the walk.
+    std::set<unsigned long> setVisited;
+    while ((ulNode || !vecStack.empty()) && !IsLimitReached(vecNodes.size(), iLimit))
+    {
+        // Descend to the leftmost node
+        while (ulNode)
+        {
+            if (vecStack.size() >= MAX_TREE_DEPTH)
+                BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "Tree is too deep. It's probably corrupt.")
+
+            if (!setVisited.insert(ulNode).second)
+                BOOST_RAISE_EXCEPTION(PyExc_RuntimeError, "Tree contains a cycle. It's probably corrupt.")
+
+            vecStack.push_back(ulNode);
+            PREFETCH(ulNode + iRightOffset);
+            ulNode = ReadLink(ulNode, iLeftOffset);
+            if (ulNode == ulNil)
+                ulNode = 0;
+        }
+
+        ulNode = vecStack.back();
+        vecStack.pop_back();
+        vecNodes.push_back(ulNode);
+
+        ulNode = ReadLink(ulNode, iRightOffset);
+        if (ulNode == ulNil)
+            ulNode = 0;
+    }
+
+    return CreatePyArray(NATIVE_PTR, vecNodes.empty() ? NULL : &vecNodes[0], vecNodes.size());
+}
+
+object WalkBuckets(object oBuckets, int iBucketCount, int iNextOffset, int iLimit /* = -1 */)
+{
+    unsigned long* pBuckets = (unsigned long *) ExtractPyPtr(oBuckets);
+    if (!pBuckets)
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Pointer is NULL.")
+
+    CollectNodes visitor;
+    for (int i=0; i < iBucketCount && !IsLimitReached(visitor.m_vecNodes.size(), iLimit); i++)
+    {
+        int iRemaining = iLimit < 0 ? -1 : iLimit - (int) visitor.m_vecNodes.size();
+        VisitList(pBuckets[i], iNextOffset, iRemaining, visitor);
+    }
+
+    std::vector<unsigned long>& vecNodes = visitor.m_vecNodes;
+    return CreatePyArray(NATIVE_PTR, vecNodes.empty() ? NULL : &vecNodes[0], vecNodes.size());
+}
+
+object CollectList(object oHead, int iNextOffset, int iFieldOffset, const char* szType, int iLimit /* = -1 */, object oStop /* = object() */)
+{
+    NativeType_t eType = ExtractNativeType(szType);
+    int iSize = GetNativeTypeSize(eType);
+    if (!GetArrayTypeCode(eType))
+        BOOST_RAISE_EXCEPTION(PyExc_ValueError, "Type is not supported by the array module.")
+
+    // Convert the stop value into its native representation
+    unsigned char pStop[sizeof(long double)];
+    if (!oStop.is_none() && !WriteNativeValue(eType, (unsigned long) pStop, oStop.ptr()))
+        throw_error_already_set();
+
+    CollectFields visitor(iFieldOffset, iSize, oStop.is_none() ? NULL : pStop);
+    VisitList(ExtractPyPtr(oHead), iNextOffset, iLimit, visitor);
+
+    std::vector<unsigned char>& vecData = visitor.m_vecData;
+    return CreatePyArray(eType, vecData.empty() ? NULL : &vecData[0], vecData.size() / iSize);
+}
@@ -0,0 +1,73 @@
+/**
+* =============================================================================
+* binutils
+* Copyright(C) 2013 Ayuto. All rights reserved.
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 3.0, as published by the
+* Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef _BINUTILS_TRAVERSAL_H
+#define _BINUTILS_TRAVERSAL_H
+
+// ============================================================================
+// >> INCLUDES
+// ============================================================================
+#include "boost/python.hpp"
+using namespace boost::python;
+
+
+// ============================================================================
+// >> DEFINITIONS
+// ============================================================================
+// Trees deeper than this are considered to be corrupt (or cyclic)
+#define MAX_TREE_DEPTH 4096
+
+
+// ============================================================================
+// >> FUNCTIONS
+// ============================================================================
+/*
+    Follows the pointer at <next_offset> starting at <head> and returns the
+    addresses of all visited nodes as an array.array('L') object. The walk
+    stops at a NULL pointer, after <limit> nodes (if not -1) or when a cycle
+    was detected.
+*/
+object WalkList(object oHead, int iNextOffset, int iLimit = -1);
+
+/*
+    Walks a binary tree in-order and returns the addresses of all visited
+    nodes as an array.array('L') object. A branch ends at NULL or at <nil>,
+    which is the address of the sentinel node if the tree uses one. Links
+    must be pointers, so trees that link their nodes by index (like
+    CUtlRBTree) are not supported. A RuntimeError is raised if a node is
+    reached twice, so a corrupt tree can't hang the server.
+*/
+object WalkTree(object oRoot, int iLeftOffset, int iRightOffset, int iLimit = -1, object oNil = object());
+
+/*
+    Walks the chains of a hash table. <buckets> points to an array of
+    <bucket_count> list heads. Returns the addresses of all nodes as an
+    array.array('L') object.
+*/
+object WalkBuckets(object oBuckets, int iBucketCount, int iNextOffset, int iLimit = -1);
+
+/*
+    Walks a linked list like WalkList(), but returns the value of the given
+    type at <field_offset> of every node as an array.array object. If <stop>
+    is not None, the walk stops before the first node whose field equals that
+    value.
+*/
+object CollectList(object oHead, int iNextOffset, int iFieldOffset, const char* szType, int iLimit = -1, object oStop = object());
+
+#endif // _BINUTILS_TRAVERSAL_H
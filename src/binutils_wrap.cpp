@@ -25,6 +25,11 @@
 #include "binutils_tools.h"
 #include "binutils_hooks.h"
 #include "binutils_callback.h"
+#include "binutils_accessors.h"
+#include "binutils_batch.h"
+#include "binutils_traversal.h"
+#include "binutils_memory.h"
+#include "binutils_descriptors.h"
 
 #include "dyncall.h"
 
@@ -34,18 +39,30 @@ void ExposeArrays();
 void ExposeDynCall();
 void ExposeDynamicHooks();
 void ExposeCallbacks();
+void ExposeBatch();
+void ExposeTraversal();
+void ExposeMemory();
 
 // ============================================================================
 // >> Expose the binutils module
 // ============================================================================
 BOOST_PYTHON_MODULE(_binutils)
 {
+    // Required to release the GIL in native calls and to acquire it again in
+    // hooks and callbacks
+    PyEval_InitThreads();
+
     ExposeScanner();
     ExposeTools();
     ExposeArrays();
+    ExposeAccessors();
     ExposeDynCall();
     ExposeDynamicHooks();
     ExposeCallbacks();
+    ExposeBatch();
+    ExposeTraversal();
+    ExposeMemory();
+    ExposeDescriptors();
 }
 
 // ============================================================================
@@ -62,30 +79,26 @@ void ExposeScanner()
         .def("find_signature",
             &CBinaryFile::FindSignature,
             "Returns the address of a signature found in memory.",
-            args("signature"),
-            manage_new_object_policy()
+            args("signature")
         )
 
         .def("find_symbol",
             &CBinaryFile::FindSymbol,
             "Returns the address of a symbol found in memory.",
-            args("symbol"),
-            manage_new_object_policy()
+            args("symbol")
         )
 
         .def("find_pointer",
             &CBinaryFile::FindPointer,
             "Rips out a pointer from a function.",
-            args("signature", "offset"),
-            manage_new_object_policy()
+            args("signature", "offset")
         )
 
         // Special methods
         .def("__getitem__",
             &CBinaryFile::FindSymbol,
             "Returns the address of a symbol found in memory.",
-            args("symbol"),
-            manage_new_object_policy()
+            args("symbol")
         )
 
         // Properties
@@ -116,42 +129,6 @@ void ExposeScanner()
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(make_function_overload, CPointer::MakeFunction, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(make_virtual_function_overload, CPointer::MakeVirtualFunction, 3, 4)
 
-// get_<type> methods
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_bool_overload,         CPointer::Get<bool>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_char_overload,         CPointer::Get<char>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_uchar_overload,        CPointer::Get<unsigned char>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_short_overload,        CPointer::Get<short>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_ushort_overload,       CPointer::Get<unsigned short>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_int_overload,          CPointer::Get<int>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_uint_overload,         CPointer::Get<unsigned int>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_long_overload,         CPointer::Get<long>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_ulong_overload,        CPointer::Get<unsigned long>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_long_long_overload,    CPointer::Get<long long>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_ulong_long_overload,   CPointer::Get<unsigned long long>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_float_overload,        CPointer::Get<float>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_double_overload,       CPointer::Get<double>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_ptr_overload,          CPointer::GetPtr, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_string_overload,       CPointer::Get<const char *>, 0, 1)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_string_array_overload, CPointer::GetStringArray, 0, 1)
-
-// set_<type> methods
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_bool_overload,         CPointer::Set<bool>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_char_overload,         CPointer::Set<char>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_uchar_overload,        CPointer::Set<unsigned char>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_short_overload,        CPointer::Set<short>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_ushort_overload,       CPointer::Set<unsigned short>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_int_overload,          CPointer::Set<int>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_uint_overload,         CPointer::Set<unsigned int>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_long_overload,         CPointer::Set<long>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_ulong_overload,        CPointer::Set<unsigned long>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_long_long_overload,    CPointer::Set<long long>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_ulong_long_overload,   CPointer::Set<unsigned long long>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_float_overload,        CPointer::Set<float>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_double_overload,       CPointer::Set<double>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_ptr_overload,          CPointer::SetPtr, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_string_overload,       CPointer::Set<const char *>, 1, 2)
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(set_string_array_overload, CPointer::SetStringArray, 1, 3)
-
 // make_<type>_array methods
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(make_bool_array_overload,       CPointer::MakeArray<bool>, 0, 1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(make_char_array_overload,       CPointer::MakeArray<char>, 0, 1)
@@ -179,15 +156,13 @@ void ExposeTools()
         .def("get_virtual_func",
             &CPointer::GetVirtualFunc,
             "Returns the address (as a CPointer instance) of a virtual function at the given index.",
-            args("index"),
-            manage_new_object_policy()
+            args("index")
         )
 
         .def("__getitem__",
             &CPointer::GetVirtualFunc,
             "Returns the address (as a CPointer instance) of a virtual function at the given index.",
-            args("index"),
-            manage_new_object_policy()
+            args("index")
         )
 
         .def("realloc",
@@ -231,8 +206,7 @@ void ExposeTools()
         .def("search_bytes",
             &CPointer::SearchBytes,
             "Searches within the first <num_bytes> of this memory block for the first occurence of <bytes> and returns a pointer it.",
-            args("bytes", "num_bytes"),
-            manage_new_object_policy()
+            args("bytes", "num_bytes")
         )
 
         .def("copy",
@@ -368,232 +342,6 @@ void ExposeTools()
             )
         )
 
-        // get_<type> methods
-        .def("get_bool",
-            &CPointer::Get<bool>,
-            get_bool_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a boolean.")
-        )
-
-        .def("get_char",
-            &CPointer::Get<char>,
-            get_char_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a char.")
-        )
-
-        .def("get_uchar",
-            &CPointer::Get<unsigned char>,
-            get_uchar_overload(
-                args("offset"),
-                "Returns the value at the given memory location as an unsgined char.")
-        )
-
-        .def("get_short",
-            &CPointer::Get<short>,
-            get_short_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a short.")
-        )
-
-        .def("get_ushort",
-            &CPointer::Get<unsigned short>,
-            get_ushort_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a unsigned short.")
-        )
-
-        .def("get_int",
-            &CPointer::Get<int>,
-            get_int_overload(
-                args("offset"),
-                "Returns the value at the given memory location as an integer.")
-        )
-
-        .def("get_uint",
-            &CPointer::Get<unsigned int>,
-            get_uint_overload(
-                args("offset"),
-                "Returns the value at the given memory location as an unsigned integer.")
-        )
-
-        .def("get_long",
-            &CPointer::Get<long>,
-            get_long_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a long.")
-        )
-
-        .def("get_ulong",
-            &CPointer::Get<unsigned long>,
-            get_ulong_overload(
-                args("offset"),
-                "Returns the value at the given memory location as an unsigned long.")
-        )
-
-        .def("get_long_long",
-            &CPointer::Get<long long>,
-            get_long_long_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a long long.")
-        )
-
-        .def("get_ulong_long",
-            &CPointer::Get<unsigned long long>,
-            get_ulong_long_overload(
-                args("offset"),
-                "Returns the value at the given memory location as an unsigned long long.")
-        )
-
-        .def("get_float",
-            &CPointer::Get<float>,
-            get_float_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a float.")
-        )
-
-        .def("get_double",
-            &CPointer::Get<double>,
-            get_double_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a double.")
-        )
-
-        .def("get_ptr",
-            &CPointer::GetPtr,
-            get_ptr_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a CPointer instance.")[manage_new_object_policy()]
-        )
-
-        .def("get_string",
-            &CPointer::Get<const char *>,
-            get_string_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a string.")
-        )
-
-        .def("get_string_array",
-            &CPointer::GetStringArray,
-            get_string_array_overload(
-                args("offset"),
-                "Returns the value at the given memory location as a string.")
-        )
-
-        // set_<type> methods
-        .def("set_bool",
-            &CPointer::Set<bool>,
-            set_bool_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a boolean.")
-        )
-
-        .def("set_char",
-            &CPointer::Set<char>,
-            set_char_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a char.")
-        )
-
-        .def("set_uchar",
-            &CPointer::Set<unsigned char>,
-            set_uchar_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an unsigned char.")
-        )
-
-        .def("set_short",
-            &CPointer::Set<short>,
-            set_short_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a short.")
-        )
-
-        .def("set_ushort",
-            &CPointer::Set<unsigned short>,
-            set_ushort_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an unsigned short.")
-        )
-
-        .def("set_int",
-            &CPointer::Set<int>,
-            set_int_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an integer.")
-        )
-
-        .def("set_uint",
-            &CPointer::Set<unsigned int>,
-            set_uint_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an unsigned integer.")
-        )
-
-        .def("set_long",
-            &CPointer::Set<long>,
-            set_long_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a long.")
-        )
-
-        .def("set_ulong",
-            &CPointer::Set<unsigned long>,
-            set_ulong_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an unsigned long.")
-        )
-
-        .def("set_long_long",
-            &CPointer::Set<long long>,
-            set_long_long_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a long long.")
-        )
-
-        .def("set_ulong_long",
-            &CPointer::Set<unsigned long long>,
-            set_ulong_long_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as an unsigned long long.")
-        )
-
-        .def("set_float",
-            &CPointer::Set<float>,
-            set_float_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a float.")
-        )
-
-        .def("set_double",
-            &CPointer::Set<double>,
-            set_double_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a double.")
-        )
-
-        .def("set_ptr",
-            &CPointer::SetPtr,
-            set_ptr_overload(
-                args("value", "offset"),
-                "Sets the value at the given memory location as a pointer.")
-        )
-
-        .def("set_string",
-            &CPointer::Set<const char *>,
-            set_string_overload(
-            args("text", "offset"),
-                "Sets the value at the given memory location as a string.")
-        )
-
-        .def("set_string_array",
-            &CPointer::SetStringArray,
-            set_string_array_overload(
-            args("text", "offset", "size"),
-                "Sets the value at the given memory location as a string.")
-        )
-
         // Special methods
         .def("__int__",
             &CPointer::GetAddress,
@@ -637,7 +385,8 @@ void ExposeTools()
 
 
     // CFunction class
-    class_<CFunction, bases<CPointer> >("Function", init<unsigned long, Convention_t, char*, optional<PyObject*> >())
+    class_<CFunction, bases<CPointer> >("Function", init<unsigned long, Convention_t, char*, optional<PyObject*, bool> >(
+            (arg("address"), arg("convention"), arg("parameters"), arg("converter")=object(), arg("release_gil")=false)))
         .def(init<const CFunction&>())
 
         // Class methods
@@ -651,14 +400,31 @@ void ExposeTools()
             "Calls the trampoline function dynamically."
         )
 
+        .def("__map",
+            &CFunction::Map,
+            (arg("arrays"), arg("nonzero")=false),
+            "Calls the function once per index of the given arrays in one native loop and returns the "\
+            "results as an array.array object. Arguments that are not arrays are passed to every call. "\
+            "If <nonzero> is True, only non-zero results are returned as a tuple (indices, results)."
+        )
+
+        .def("compile",
+            &CFunction::Compile,
+            "Generates a call stub, which is used instead of dyncall to call the function."
+        )
+
         .def("add_pre_hook",
             &CFunction::AddPreHook,
-            "Adds a pre-hook callback."
+            (arg("callback"), arg("predicate")=object()),
+            "Adds a pre-hook callback. If a HookPredicate is given, the callback is only called if "\
+            "the predicate matches."
         )
 
         .def("add_post_hook",
             &CFunction::AddPostHook,
-            "Adds a post-hook callback."
+            (arg("callback"), arg("predicate")=object()),
+            "Adds a post-hook callback. If a HookPredicate is given, the callback is only called if "\
+            "the predicate matches."
         )
 
         .def("remove_pre_hook",
@@ -671,6 +437,30 @@ void ExposeTools()
             "Removes a post-hook callback."
         )
 
+        .def("add_native_pre_hook",
+            &CFunction::AddNativePreHook,
+            "Adds a native pre-hook callback, which is called without entering Python. Accepts an "\
+            "address, a Pointer object, a ctypes function pointer or a (library path, symbol name) "\
+            "tuple. The callback has the signature bool (*)(int hook_type, void* hook) and returns true "\
+            "to override the return value. It reads and writes the arguments and the return value through "\
+            "the NativeHookApi_t returned by get_native_hook_api() (see binutils_hook_api.h)."
+        )
+
+        .def("add_native_post_hook",
+            &CFunction::AddNativePostHook,
+            "Adds a native post-hook callback. See add_native_pre_hook()."
+        )
+
+        .def("remove_native_pre_hook",
+            &CFunction::RemoveNativePreHook,
+            "Removes a native pre-hook callback."
+        )
+
+        .def("remove_native_post_hook",
+            &CFunction::RemoveNativePostHook,
+            "Removes a native post-hook callback."
+        )
+
         // Attributes
         .add_property("parameters",
             &CFunction::GetParams,
@@ -687,16 +477,44 @@ void ExposeTools()
             &CFunction::m_oConverter,
             "Returns the converter."
         )
+
+        .def_readwrite("release_gil",
+            &CFunction::m_bReleaseGIL,
+            "If True, other Python threads can run while the function is called."
+        )
+
+        .add_property("stats",
+            &CFunction::GetStats,
+            "Returns a dict with the call statistics (count, total, min, max and histogram) in "\
+            "timestamp ticks. Bucket i of the histogram counts the calls that took 2^i to 2^(i+1)-1 ticks. "\
+            "Calls are only recorded while profiling is enabled."
+        )
+
+        .def("reset_stats",
+            &CFunction::ResetStats,
+            "Resets the call statistics."
+        )
     ;
 
     DEFINE_CLASS_METHOD_VARIADIC(Function, __call__);
     DEFINE_CLASS_METHOD_VARIADIC(Function, call_trampoline);
+    scope().attr("Function").attr("map") = eval("lambda self, *args, **kwargs: self.__map(args, **kwargs)");
 
     def("alloc",
         Alloc,
         args("size"),
-        "Allocates a memory block.",
-        manage_new_object_policy()
+        "Allocates a memory block."
+    );
+
+    def("set_profiling",
+        &SetProfiling,
+        args("enabled"),
+        "Enables or disables recording call statistics for all Function objects."
+    );
+
+    def("is_profiling",
+        &IsProfiling,
+        "Returns True if call statistics are recorded."
     );
 }
 
@@ -704,10 +522,9 @@ void ExposeTools()
 // ============================================================================
 // >> Expose Arrays
 // ============================================================================
+// The __getitem__ and __setitem__ methods are added by ExposeAccessors().
 #define EXPOSE_ARRAY(type, classname) \
     class_< CArray<type>, bases<CPointer> >(classname, init<unsigned long, optional<int> >()) \
-        .def("__getitem__", &CArray<type>::GetItem) \
-        .def("__setitem__", &CArray<type>::SetItem) \
         .def_readwrite("length", &CArray<type>::m_iLength) \
         .def_readwrite("size", &CArray<type>::m_iTypeSize) \
     ;
@@ -775,6 +592,41 @@ void ExposeDynamicHooks()
             "Sets the argument at the specified index."
         )
     ;
+
+    class_<CHookPredicate>("HookPredicate", init<>())
+        .def("arg",
+            &CHookPredicate::Arg,
+            (arg("index"), arg("op"), arg("value"), arg("mask")=object()),
+            "Adds a term that compares the argument at the given index. Supported operators are ==, "\
+            "!=, <, <=, >, >=, & (bits are set) and in (value is in a sequence). If a mask is given, "\
+            "it's applied to the argument and the value before they are compared. Values are converted to "\
+            "the type of the argument when the predicate is registered, so -1 and 0xFFFFFFFF match the same int."
+        )
+
+        .def("field",
+            &CHookPredicate::Field,
+            (arg("index"), arg("offset"), arg("op"), arg("value"), arg("size")=4, arg("signed")=false, arg("mask")=object()),
+            "Adds a term that compares the value at <argument> + <offset>. The term doesn't match if "\
+            "the argument is NULL. Values are converted to <size> bytes and <signed>."
+        )
+    ;
+
+    def("get_native_hook_api",
+        &GetNativeHookApi,
+        "Returns the address of the NativeHookApi_t, which native hook callbacks use to access the "\
+        "arguments and the return value of the hook. Pass it to the library of the callbacks before "\
+        "they are registered."
+    );
+
+    def("get_hook_count",
+        &GetHookCount,
+        "Returns the number of hooked functions."
+    );
+
+    def("get_hooks",
+        &GetHooks,
+        "Returns a list of all hooks sorted by address: [(function, trampoline, convention, parameters), ...]"
+    );
 }
 
 // ============================================================================
@@ -793,4 +645,222 @@ void ExposeCallbacks()
             "The Python function that gets called by the C++ callback"
         )
     ;
+}
+
+// ============================================================================
+// >> Expose batch functions
+// ============================================================================
+// Overloads
+BOOST_PYTHON_FUNCTION_OVERLOADS(gather_overload, Gather, 3, 4);
+BOOST_PYTHON_FUNCTION_OVERLOADS(scatter_overload, Scatter, 4, 5);
+
+void ExposeBatch()
+{
+    def("gather",
+        &Gather,
+        gather_overload(
+            args("ptrs", "offset", "type", "prefetch"),
+            "Reads the value of the given type at <offset> from all pointers in one native loop and returns "\
+            "them as an array.array object. NULL pointers result in a zero value.")
+    );
+
+    def("scatter",
+        &Scatter,
+        scatter_overload(
+            args("ptrs", "offset", "type", "values", "prefetch"),
+            "Writes the values (a buffer, a sequence or a single value) to <offset> of all pointers in one "\
+            "native loop. NULL pointers are skipped. Returns the number of written values.")
+    );
+
+    class_<CReadPlan, boost::noncopyable>("ReadPlan")
+
+        // Class methods
+        .def("add",
+            &CReadPlan::Add,
+            "Adds a value to the plan and returns its index. <offsets> is a single offset or a sequence of offsets. "\
+            "All offsets except the last one are dereferenced. Strings are not supported and pointers are read as "\
+            "their address.",
+            args("base", "offsets", "type")
+        )
+
+        .def("refresh",
+            &CReadPlan::Refresh,
+            "Reads all values into the buffer. Values of broken pointer chains are set to zero. Returns the number "\
+            "of read values."
+        )
+
+        .def("invalidate",
+            &CReadPlan::Invalidate,
+            "Forces all pointer chains to be resolved again on the next refresh."
+        )
+
+        // Special methods
+        .def("__len__",
+            &CReadPlan::GetLength,
+            "Returns the number of values."
+        )
+
+        // Properties
+        .add_property("buffer",
+            &CReadPlan::GetBuffer,
+            "Returns the bytearray that contains the values."
+        )
+
+        .add_property("view",
+            &CReadPlan::GetView,
+            "Returns a memoryview of the buffer. Release it before adding more values."
+        )
+
+        .add_property("format",
+            &CReadPlan::GetFormat,
+            "Returns the struct module format of the buffer."
+        )
+    ;
+}
+
+// ============================================================================
+// >> Expose traversal functions
+// ============================================================================
+// Overloads
+BOOST_PYTHON_FUNCTION_OVERLOADS(walk_list_overload, WalkList, 2, 3);
+BOOST_PYTHON_FUNCTION_OVERLOADS(walk_tree_overload, WalkTree, 3, 5);
+BOOST_PYTHON_FUNCTION_OVERLOADS(walk_buckets_overload, WalkBuckets, 3, 4);
+BOOST_PYTHON_FUNCTION_OVERLOADS(collect_overload, CollectList, 4, 6);
+
+void ExposeTraversal()
+{
+    def("walk_list",
+        &WalkList,
+        walk_list_overload(
+            args("head", "next_offset", "limit"),
+            "Follows the pointer at <next_offset> starting at <head> and returns the addresses of all nodes as an "\
+            "array.array object. Stops at a NULL pointer, after <limit> nodes or when a cycle was detected.")
+    );
+
+    def("walk_tree",
+        &WalkTree,
+        walk_tree_overload(
+            args("root", "left_offset", "right_offset", "limit", "nil"),
+            "Walks a binary tree in-order and returns the addresses of all nodes as an array.array object. "\
+            "Branches end at NULL or at <nil>, the address of the sentinel node if the tree uses one. Raises a "\
+            "RuntimeError if the tree contains a cycle.")
+    );
+
+    def("walk_buckets",
+        &WalkBuckets,
+        walk_buckets_overload(
+            args("buckets", "bucket_count", "next_offset", "limit"),
+            "Walks the chains of all buckets of a hash table and returns the addresses of all nodes as an "\
+            "array.array object.")
+    );
+
+    def("collect",
+        &CollectList,
+        collect_overload(
+            args("head", "next_offset", "field_offset", "type", "limit", "stop"),
+            "Walks a linked list and returns the value of the given type at <field_offset> of every node as an "\
+            "array.array object. Stops before the first node whose field equals <stop>, if it's not None.")
+    );
+}
+
+// ============================================================================
+// >> Expose memory scanning
+// ============================================================================
+// Overloads
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(first_scan_overload, CValueScanner::FirstScan, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(next_scan_overload, CValueScanner::NextScan, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(get_results_overload, CValueScanner::GetResults, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(diff_overload, CSnapshot::Diff, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(diff_fields_overload, CSnapshot::DiffFields, 1, 2)
+
+void ExposeMemory()
+{
+    enum_<ScanType_t>("ScanType")
+        .value("EXACT", SCAN_EXACT)
+        .value("RANGE", SCAN_RANGE)
+        .value("UNKNOWN", SCAN_UNKNOWN)
+        .value("CHANGED", SCAN_CHANGED)
+        .value("UNCHANGED", SCAN_UNCHANGED)
+        .value("INCREASED", SCAN_INCREASED)
+        .value("DECREASED", SCAN_DECREASED)
+    ;
+
+    class_<CValueScanner, boost::noncopyable>("ValueScanner", init<object, const char*, optional<int> >())
+
+        // Class methods
+        .def("first_scan",
+            &CValueScanner::FirstScan,
+            first_scan_overload(
+                args("scan_type", "value", "max"),
+                "Scans all regions and creates the candidates. Allowed are EXACT, RANGE and UNKNOWN. "\
+                "Returns the number of candidates.")
+        )
+
+        .def("next_scan",
+            &CValueScanner::NextScan,
+            next_scan_overload(
+                args("scan_type", "value", "max"),
+                "Removes all candidates that don't match anymore. The previous values are the ones of the last "\
+                "scan. Returns the number of remaining candidates.")
+        )
+
+        .def("reset",
+            &CValueScanner::Reset,
+            "Removes all candidates."
+        )
+
+        .def("get_results",
+            &CValueScanner::GetResults,
+            get_results_overload(
+                args("limit"),
+                "Returns the addresses of the candidates as an array.array object.")
+        )
+
+        // Properties
+        .add_property("count",
+            &CValueScanner::GetCount,
+            "Returns the number of candidates."
+        )
+
+        .def_readonly("alignment",
+            &CValueScanner::m_iAlignment,
+            "Returns the distance between two slots."
+        )
+    ;
+
+    class_<CSnapshot, boost::noncopyable>("Snapshot", init<object>())
+
+        // Class methods
+        .def("update",
+            &CSnapshot::Update,
+            "Copies the current state of the regions into the snapshot."
+        )
+
+        .def("restore",
+            &CSnapshot::Restore,
+            "Writes the snapshot back to the regions."
+        )
+
+        .def("diff",
+            &CSnapshot::Diff,
+            diff_overload(
+                args("merge_distance"),
+                "Returns a list of (Pointer, size) tuples of all byte ranges that have changed since the snapshot. "\
+                "Ranges that are not more than <merge_distance> bytes apart are merged.")
+        )
+
+        .def("diff_fields",
+            &CSnapshot::DiffFields,
+            diff_fields_overload(
+                args("type", "alignment"),
+                "Returns a list of (Pointer, old_value, new_value) tuples of all fields of the given type that "\
+                "have changed since the snapshot.")
+        )
+
+        // Properties
+        .add_property("size",
+            &CSnapshot::GetSize,
+            "Returns the number of bytes stored in the snapshot."
+        )
+    ;
 }
\ No newline at end of file
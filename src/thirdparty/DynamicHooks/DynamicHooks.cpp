@@ -31,6 +31,11 @@
 // ============================================================================
 // >> INCLUDES
 // ============================================================================
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
 #include "DynamicHooks.h"
 using namespace DynamicHooks;
 
@@ -46,31 +51,63 @@ using namespace AsmJit;
 // ============================================================================
 #define JMP_SIZE 6
 
+// Flags for the hook types a bridge handles. A bridge without any flags is
+// not required, because the trampoline can be used directly.
+#define BRIDGE_PRE  (1 << HOOKTYPE_PRE)
+#define BRIDGE_POST (1 << HOOKTYPE_POST)
+
+// Initial number of frames of a thread's hook stack. It grows on demand.
+#define HOOK_STACK_SIZE 32
+
+#ifdef _WIN32
+	#include <intrin.h>
+	#define HOOK_THREAD_LOCAL __declspec(thread)
+	#define HOOK_ATOMIC_INCREMENT(var) _InterlockedIncrement(&(var))
+	#define HOOK_ATOMIC_DECREMENT(var) _InterlockedDecrement(&(var))
+	#define HOOK_ATOMIC_STORE(ptr, value) (void) _InterlockedExchange((volatile long *) (ptr), (long) (value))
+#else
+	#define HOOK_THREAD_LOCAL __thread
+	#define HOOK_ATOMIC_INCREMENT(var) __sync_add_and_fetch(&(var), 1)
+	#define HOOK_ATOMIC_DECREMENT(var) __sync_sub_and_fetch(&(var), 1)
+	#define HOOK_ATOMIC_STORE(ptr, value) do { (void) __sync_lock_test_and_set((ptr), (value)); __sync_synchronize(); } while (0)
+#endif
+
 
 // ============================================================================
 // >> CHookManager
 // ============================================================================
+CHookManager::CHookManager()
+{
+	m_iGeneration = 0;
+}
+
 CHook* CHookManager::HookFunction(void* pFunc, Convention_t eConvention, char* szParams)
 {
 	if (!pFunc)
 		return NULL;
 
-	CHook* pHook = FindHook(pFunc);
-	if (pHook)
-		return pHook;
+	std::vector<CHook *>::iterator it = LowerBound(pFunc);
+	if (it != m_Hooks.end() && (*it)->m_pFunc == pFunc)
+		return *it;
 	
-	pHook = new CHook(pFunc, eConvention, szParams);
-	m_Hooks.push_back(pHook);
+	CHook* pHook = new CHook(pFunc, eConvention, szParams);
+	m_Hooks.insert(it, pHook);
+	m_iGeneration++;
 	return pHook;
 }
 
 void CHookManager::UnhookFunction(void* pFunc)
 {
-	CHook* pHook = FindHook(pFunc);
-	if (pHook)
+	if (!pFunc)
+		return;
+
+	std::vector<CHook *>::iterator it = LowerBound(pFunc);
+	if (it != m_Hooks.end() && (*it)->m_pFunc == pFunc)
 	{
-		m_Hooks.remove(pHook);
+		CHook* pHook = *it;
+		m_Hooks.erase(it);
 		delete pHook;
+		m_iGeneration++;
 	}
 }
 
@@ -79,44 +116,131 @@ CHook* CHookManager::FindHook(void* pFunc)
 	if (!pFunc)
 		return NULL;
 
-	for(std::list<CHook *>::iterator it=m_Hooks.begin(); it != m_Hooks.end(); it++)
-	{
-		CHook* pHook = *it;
-		if (pHook->m_pFunc == pFunc)
-			return pHook;
-	}
+	std::vector<CHook *>::iterator it = LowerBound(pFunc);
+	if (it != m_Hooks.end() && (*it)->m_pFunc == pFunc)
+		return *it;
+
 	return NULL;
 }
 
 void CHookManager::UnhookAllFunctions()
 {
-	for(std::list<CHook *>::iterator it=m_Hooks.begin(); it != m_Hooks.end(); it++)
+	for(std::vector<CHook *>::iterator it=m_Hooks.begin(); it != m_Hooks.end(); it++)
 		delete *it;
 
 	m_Hooks.clear();
+	m_iGeneration++;
+}
+
+int CHookManager::GetHookCount()
+{
+	return (int) m_Hooks.size();
+}
+
+CHook* CHookManager::GetHook(int iIndex)
+{
+	if (iIndex < 0 || iIndex >= (int) m_Hooks.size())
+		return NULL;
+
+	return m_Hooks[iIndex];
+}
+
+bool CompareHookAddress(CHook* pHook, void* pFunc)
+{
+	return (unsigned long) pHook->m_pFunc < (unsigned long) pFunc;
+}
+
+std::vector<CHook *>::iterator CHookManager::LowerBound(void* pFunc)
+{
+	return std::lower_bound(m_Hooks.begin(), m_Hooks.end(), pFunc, CompareHookAddress);
+}
+
+
+// ============================================================================
+// >> Hook stack
+// ============================================================================
+struct HookStack_t
+{
+	int          m_iCount;
+	int          m_iSize;
+	HookFrame_t* m_pFrames;
+};
+
+// Frames of all hooks the current thread is executing. The innermost frame
+// is the last one.
+static HOOK_THREAD_LOCAL HookStack_t t_HookStack;
+
+/*
+	Called by the bridge when it's entered. <pESP> points to the return
+	address of the hooked function.
+*/
+void PushHookFrame(CHook* pHook, void* pESP, void* pECX)
+{
+	HookStack_t* pStack = &t_HookStack;
+	if (pStack->m_iCount == pStack->m_iSize)
+	{
+		pStack->m_iSize = pStack->m_iSize ? pStack->m_iSize * 2 : HOOK_STACK_SIZE;
+		pStack->m_pFrames = (HookFrame_t *) realloc(pStack->m_pFrames, pStack->m_iSize * sizeof(HookFrame_t));
+	}
+
+	HookFrame_t* pFrame = &pStack->m_pFrames[pStack->m_iCount++];
+	pFrame->m_pHook    = pHook;
+	pFrame->m_pESP     = pESP;
+	pFrame->m_pECX     = pECX;
+	pFrame->m_pRetAddr = *(void **) pESP;
+}
+
+/*
+	Removes the innermost frame and returns it. The frame stays valid until
+	the next frame is pushed.
+*/
+HookFrame_t* PopHookFrame()
+{
+	return &t_HookStack.m_pFrames[--t_HookStack.m_iCount];
+}
+
+HookFrame_t* GetTopHookFrame()
+{
+	return &t_HookStack.m_pFrames[t_HookStack.m_iCount - 1];
+}
+
+namespace DynamicHooks {
+int GetHookFrameCount()
+{
+	return t_HookStack.m_iCount;
+}
+
+HookFrame_t* GetHookFrame(int iDepth)
+{
+	if (iDepth < 0 || iDepth >= t_HookStack.m_iCount)
+		return NULL;
+
+	return &t_HookStack.m_pFrames[t_HookStack.m_iCount - 1 - iDepth];
+}
 }
 
 
 // ============================================================================
 // >> CHook
 // ============================================================================
-void* CreateBridge(CHook*);
+void* CreateDispatcher(CHook*);
+void* CreateBridge(CHook*, int);
 
 CHook::CHook(void* pFunc, Convention_t eConvention, char* szParams)
 {
 	m_pFunc       = pFunc;
 	m_eConvention = eConvention;
-	m_szParams    = szParams;
+	m_szParams    = strdup(szParams);
 
 	// Parse the parameters
-	m_pParams    = new Param_t;
 	m_pRetParam  = new Param_t;
-	ParseParams(eConvention, szParams, m_pParams, m_pRetParam);
+	m_iArgumentCount = ParseParams(eConvention, szParams, &m_pParams, m_pRetParam);
+
+	m_pUserData = NULL;
 
-	// Allocate space for the return register buffer
-	m_pRetReg = malloc(m_pRetParam->m_iSize);
-	m_pESP = NULL;
-	m_pECX = NULL;
+	m_pCallbacks[HOOKTYPE_PRE] = NULL;
+	m_pCallbacks[HOOKTYPE_POST] = NULL;
+	m_iRunningHandlers = 0;
 
 	unsigned char* pTarget = (unsigned char *) pFunc;
 
@@ -140,8 +264,13 @@ CHook::CHook(void* pFunc, Convention_t eConvention, char* szParams)
 	// Save the trampoline
 	m_pTrampoline = (void *) pCopiedBytes;
 
-	// Create the bridge function
-	m_pBridge = CreateBridge(this);
+	// No callbacks are registered yet, so just call the original function
+	m_pActiveBridge = m_pTrampoline;
+	memset(m_pBridges, 0, sizeof(m_pBridges));
+	m_pPostCallback = NULL;
+
+	// Create the dispatcher, which jumps to the active bridge
+	m_pBridge = CreateDispatcher(this);
 
 	// Write a jump to the bridge
 	WriteJMP((unsigned char *) pFunc, m_pBridge);
@@ -150,20 +279,20 @@ CHook::CHook(void* pFunc, Convention_t eConvention, char* szParams)
 
 CHook::~CHook()
 {
-	// Free the return register buffer
-	free(m_pRetReg);
+	// Free our copy of the parameter string
+	free(m_szParams);
 
 	// Delete the return parameter struct
 	delete m_pRetParam;
 
 	// Delete all parameters
-	Param_t* pNext = m_pParams;
-	while (pNext)
-	{
-		Param_t* temp = pNext->m_pNext;
-		delete pNext;
-		pNext = temp;
-	}
+	delete[] m_pParams;
+
+	// Free the callback lists
+	free(m_pCallbacks[HOOKTYPE_PRE]);
+	free(m_pCallbacks[HOOKTYPE_POST]);
+	for (size_t i=0; i < m_RetiredCallbacks.size(); i++)
+		free(m_RetiredCallbacks[i]);
 
 	// Copy back the previously copied bytes
 	copy_bytes((unsigned char *) m_pTrampoline, (unsigned char *) m_pFunc, JMP_SIZE);
@@ -171,69 +300,138 @@ CHook::~CHook()
 	// Free the trampoline array
 	free(m_pTrampoline);
 
-	// Free the asm bridge
+	// Free the asm bridges
+	for (int i=0; i < 4; i++)
+	{
+		if (m_pBridges[i])
+			MemoryManager::getGlobal()->free(m_pBridges[i]);
+	}
+
+	if (m_pPostCallback)
+		MemoryManager::getGlobal()->free(m_pPostCallback);
+
 	MemoryManager::getGlobal()->free(m_pBridge);
 }
 
+CallbackList_t* CreateCallbackList(int iCount)
+{
+	CallbackList_t* pList = (CallbackList_t *) malloc(sizeof(CallbackList_t) + (iCount - 1) * sizeof(void *));
+	pList->m_iCount = iCount;
+	return pList;
+}
+
 void CHook::AddCallback(HookType_t eHookType, void* pCallback)
 {
-	if (!pCallback)
+	if (!pCallback || IsCallbackRegistered(eHookType, pCallback))
 		return;
 
-	if (!IsCallbackRegistered(eHookType, pCallback))
-		m_Callbacks[eHookType].push_back(pCallback);
+	CallbackList_t* pOld = m_pCallbacks[eHookType];
+	int iOldCount = pOld ? pOld->m_iCount : 0;
+
+	CallbackList_t* pList = CreateCallbackList(iOldCount + 1);
+	if (iOldCount)
+		memcpy(pList->m_pCallbacks, pOld->m_pCallbacks, iOldCount * sizeof(void *));
+
+	pList->m_pCallbacks[iOldCount] = pCallback;
+	PublishCallbacks(eHookType, pList);
 }
 
 void CHook::RemoveCallback(HookType_t eHookType, void* pCallback)
 {
-	if (IsCallbackRegistered(eHookType, pCallback))
-		m_Callbacks[eHookType].remove(pCallback);
+	if (!IsCallbackRegistered(eHookType, pCallback))
+		return;
+
+	CallbackList_t* pOld = m_pCallbacks[eHookType];
+	CallbackList_t* pList = NULL;
+	if (pOld->m_iCount > 1)
+	{
+		pList = CreateCallbackList(pOld->m_iCount - 1);
+		for (int i=0, j=0; i < pOld->m_iCount; i++)
+		{
+			if (pOld->m_pCallbacks[i] != pCallback)
+				pList->m_pCallbacks[j++] = pOld->m_pCallbacks[i];
+		}
+	}
+	PublishCallbacks(eHookType, pList);
 }
 
 bool CHook::IsCallbackRegistered(HookType_t eHookType, void* pCallback)
 {
-	std::list<void *> callbacks = m_Callbacks[eHookType];
-	for(std::list<void *>::iterator it=callbacks.begin(); it != callbacks.end(); it++)
+	CallbackList_t* pList = m_pCallbacks[eHookType];
+	if (!pList)
+		return false;
+
+	for (int i=0; i < pList->m_iCount; i++)
 	{
-		if (*it == pCallback)
+		if (pList->m_pCallbacks[i] == pCallback)
 			return true;
 	}
 	return false;
 }
 
-int CHook::GetPopSize()
+void CHook::PublishCallbacks(HookType_t eHookType, CallbackList_t* pList)
 {
-#ifdef _WIN32
-	if (m_eConvention == CONV_THISCALL || m_eConvention == CONV_STDCALL)
+	CallbackList_t* pOld = m_pCallbacks[eHookType];
+
+	// A full barrier is required, so m_iRunningHandlers is read after the
+	// new list has been published
+	HOOK_ATOMIC_STORE(&m_pCallbacks[eHookType], pList);
+	if (pOld)
+		m_RetiredCallbacks.push_back(pOld);
+
+	if (!m_iRunningHandlers)
 	{
-		Param_t* pParam = GetArgument(GetArgumentCount() - 1);
-		return pParam->m_iOffset + pParam->m_iSize;
+		for (size_t i=0; i < m_RetiredCallbacks.size(); i++)
+			free(m_RetiredCallbacks[i]);
+
+		m_RetiredCallbacks.clear();
 	}
-#endif
-	return 0;
+
+	UpdateBridge();
+}
+
+void CHook::UpdateBridge()
+{
+	int iFlags = 0;
+	if (m_pCallbacks[HOOKTYPE_PRE])
+		iFlags |= BRIDGE_PRE;
+
+	if (m_pCallbacks[HOOKTYPE_POST])
+		iFlags |= BRIDGE_POST;
+
+	if (!iFlags)
+	{
+		m_pActiveBridge = m_pTrampoline;
+		return;
+	}
+
+	if (!m_pBridges[iFlags])
+		m_pBridges[iFlags] = CreateBridge(this, iFlags);
+
+	m_pActiveBridge = m_pBridges[iFlags];
 }
 
-int CHook::GetArgumentCount()
+int CHook::GetPopSize()
 {
-	int count = 0;
-	Param_t* temp = m_pParams;
-	while(temp)
+#ifdef _WIN32
+	if ((m_eConvention == CONV_THISCALL || m_eConvention == CONV_STDCALL) && m_iArgumentCount > 0)
 	{
-		count++;
-		temp = temp->m_pNext;
+		Param_t* pParam = GetArgument(m_iArgumentCount - 1);
+		return pParam->m_iOffset + pParam->m_iSize;
 	}
-	return count - 1;
+#endif
+	return 0;
 }
 
-Param_t* CHook::GetArgument(int iIndex)
+HookFrame_t* CHook::GetHookFrame()
 {
-	Param_t* temp = m_pParams;
-	while(temp && iIndex > 0)
+	// Usually the innermost frame belongs to this hook
+	for (int i=t_HookStack.m_iCount-1; i >= 0; i--)
 	{
-		iIndex--;
-		temp = temp->m_pNext;
+		if (t_HookStack.m_pFrames[i].m_pHook == this)
+			return &t_HookStack.m_pFrames[i];
 	}
-	return temp;
+	return NULL;
 }
 
 
@@ -254,14 +452,20 @@ CHookManager* GetHookManager()
 // ============================================================================
 int HookHandler(HookType_t eHookType, CHook* pHook)
 {
+	// Make sure the list isn't freed while we are iterating over it. The
+	// counter must be increased before the list is read.
+	HOOK_ATOMIC_INCREMENT(pHook->m_iRunningHandlers);
+
 	bool bOverride = false;
-	std::list<void *> callbacks = pHook->m_Callbacks[eHookType];
-	for(std::list<void *>::iterator it=callbacks.begin(); it != callbacks.end(); it++)
+	CallbackList_t* pList = pHook->m_pCallbacks[eHookType];
+	for (int i=0; pList && i < pList->m_iCount; i++)
 	{
-		bool result = ((HookFn) *it)(eHookType, pHook);
+		bool result = ((HookFn) pList->m_pCallbacks[i])(eHookType, pHook);
 		if (result)
 			bOverride = true;
 	}
+
+	HOOK_ATOMIC_DECREMENT(pHook->m_iRunningHandlers);
 	return bOverride;
 }
 
@@ -269,37 +473,56 @@ int HookHandler(HookType_t eHookType, CHook* pHook)
 // ============================================================================
 // >> CreateBridge
 // ============================================================================
-void Write_SaveRegisters(Assembler& a, CHook* pHook)
-{
-	a.mov(dword_ptr_abs(&pHook->m_pESP), esp);
+#define FRAME_OFFSET(member) ((sysint_t) offsetof(HookFrame_t, member))
 
-#ifdef _WIN32
-	if (pHook->m_eConvention == CONV_THISCALL)
-		// On Windows the this pointer is saved in ecx
-		a.mov(dword_ptr_abs(&pHook->m_pECX), ecx);
-#endif
+void Write_PushFrame(Assembler& a, CHook* pHook)
+{
+	// Save esp and ecx (on Windows) for later access (arguments and thisptr)
+	a.mov(eax, esp);
+	a.push(ecx);
+	a.push(eax);
+	a.push(imm((sysint_t) pHook));
+	a.call((void *) &PushHookFrame);
+	a.add(esp, 12);
 }
 
 void Write_SaveReturnValue(Assembler& a, CHook* pHook)
 {
+	// Calling GetTopHookFrame() destroys the return registers, so they are
+	// buffered on the stack first
+	a.sub(esp, 8);
+
 	char type = pHook->m_pRetParam->m_cParam;
 	if (type == SIGCHAR_FLOAT)
-		a.fst(dword_ptr_abs(pHook->m_pRetReg));
+		a.fstp(dword_ptr(esp));
 	else if (type == SIGCHAR_DOUBLE)
-		a.fst(qword_ptr_abs(pHook->m_pRetReg));
+		a.fstp(qword_ptr(esp));
 	else
-		a.mov_ptr(pHook->m_pRetReg, eax);
+	{
+		a.mov(dword_ptr(esp), eax);
+		a.mov(dword_ptr(esp, 4), edx);
+	}
+
+	a.call((void *) &GetTopHookFrame);
+	a.pop(ecx);
+	a.mov(dword_ptr(eax, FRAME_OFFSET(m_pRetReg)), ecx);
+	a.pop(ecx);
+	a.mov(dword_ptr(eax, FRAME_OFFSET(m_pRetReg) + 4), ecx);
 }
 
 void Write_RestoreReturnValue(Assembler& a, CHook* pHook)
 {
+	// ecx contains the frame
 	char type = pHook->m_pRetParam->m_cParam;
 	if (type == SIGCHAR_FLOAT)
-		a.fld(dword_ptr_abs(pHook->m_pRetReg));
+		a.fld(dword_ptr(ecx, FRAME_OFFSET(m_pRetReg)));
 	else if (type == SIGCHAR_DOUBLE)
-		a.fld(qword_ptr_abs(pHook->m_pRetReg));
+		a.fld(qword_ptr(ecx, FRAME_OFFSET(m_pRetReg)));
 	else
-		a.mov_ptr(eax, pHook->m_pRetReg);
+	{
+		a.mov(eax, dword_ptr(ecx, FRAME_OFFSET(m_pRetReg)));
+		a.mov(edx, dword_ptr(ecx, FRAME_OFFSET(m_pRetReg) + 4));
+	}
 }
 
 void Write_CallHandler(Assembler& a, CHook* pHook, HookType_t eHookType)
@@ -310,74 +533,80 @@ void Write_CallHandler(Assembler& a, CHook* pHook, HookType_t eHookType)
 	a.add(esp, 8);
 }
 
-void* CreatePostCallback(CHook* pHook)
+void* GetPostCallback(CHook* pHook)
 {
+	if (pHook->m_pPostCallback)
+		return pHook->m_pPostCallback;
+
 	Assembler a;
-	
-	// Save the return value for later access
-	Write_SaveReturnValue(a, pHook);
-	
+
 	// On Windows thiscalls and stdcalls we have to subtract the pop size, so
 	// the post-hook callbacks can access the arguments again
 	Imm iBytesToPop = imm(pHook->GetPopSize());
 
 	// Subtract the previous added bytes
 	a.sub(esp, iBytesToPop);
+	
+	// Save the return value for later access
+	Write_SaveReturnValue(a, pHook);
 
 	// Call the post-hook handler
 	Write_CallHandler(a, pHook, HOOKTYPE_POST);
 
+	// Remove our frame from the hook stack
+	a.call((void *) &PopHookFrame);
+	a.mov(ecx, eax);
+
 	// Add them again to the stack
 	a.add(esp, iBytesToPop);
 
+	// Return to the original return address
+	a.push(dword_ptr(ecx, FRAME_OFFSET(m_pRetAddr)));
+
 	// Use the new return value
 	Write_RestoreReturnValue(a, pHook);
+	a.ret();
 
-	// Jump to the original return address
-	a.jmp(dword_ptr_abs(&pHook->m_pRetAddr));
-
-	// TODO: Free this if the bridge gets freed or figure out how to get the
-	//       address of labels.
-	return a.make();
+	pHook->m_pPostCallback = a.make();
+	return pHook->m_pPostCallback;
 }
 
-void Write_ModifyReturnAddress(Assembler& a, CHook* pHook)
+void* CreateDispatcher(CHook* pHook)
 {
-	// Unfortunately, there is no Assembler::mov(Mem, Mem). That's why this
-	// workaround is required.
-	void* pEDX = NULL;
-
-	// Store edx in pEDX
-	a.mov(dword_ptr_abs(&pEDX), edx);
-
-	// Store the return address in edx
-	a.mov(edx, dword_ptr(esp));
-
-	// Store return address in m_pRetAddr, so we can access it later
-	a.mov(dword_ptr_abs(&pHook->m_pRetAddr), edx);
-
-	// Restore edx
-	a.mov(edx, dword_ptr_abs(&pEDX));
+	Assembler a;
 
-	// Override the return address. This is a redirect to our post-hook code
-	a.mov(dword_ptr(esp), imm((sysint_t) CreatePostCallback(pHook)));
+	// The active bridge might be exchanged at any time, so read it on every
+	// call
+	a.jmp(dword_ptr_abs((void *) &pHook->m_pActiveBridge));
+	return a.make();
 }
 
-void* CreateBridge(CHook* pHook)
+void* CreateBridge(CHook* pHook, int iFlags)
 {
 	Assembler a;
 	Label label_override = a.newLabel();
 
-	// Write a redirect to the post-hook code
-	Write_ModifyReturnAddress(a, pHook);
+	// Push a new frame onto the hook stack. It saves the return address, esp
+	// and ecx (on Windows)
+	Write_PushFrame(a, pHook);
 
-	// Save esp and ecx (on Windows) for later access (arguments and thisptr)
-	Write_SaveRegisters(a, pHook);
+	// Override the return address. This is a redirect to our post-hook code
+	if (iFlags & BRIDGE_POST)
+		a.mov(dword_ptr(esp), imm((sysint_t) GetPostCallback(pHook)));
 	
 	// Call the pre-hook handler and jump to label_override if true was returned
-	Write_CallHandler(a, pHook, HOOKTYPE_PRE);
-	a.cmp(eax, true);
-	a.je(label_override);
+	if (iFlags & BRIDGE_PRE)
+	{
+		Write_CallHandler(a, pHook, HOOKTYPE_PRE);
+		a.cmp(eax, true);
+		a.je(label_override);
+	}
+
+	// Without post-hooks nothing has to be done after the function returns.
+	// So the frame can be removed here and the trampoline returns directly
+	// to the caller.
+	if (!(iFlags & BRIDGE_POST))
+		a.call((void *) &PopHookFrame);
 
 #ifdef _WIN32
 	// Restore ecx, because it changes either in the global hook handler ('cause of the loop)
@@ -385,15 +614,31 @@ void* CreateBridge(CHook* pHook)
 	// requires a valid this pointer -- e.g. if it uses virtual functions of its class.
 	// TODO: Add a Write_RestorePreservedRegisters()
 	if (pHook->m_eConvention == CONV_THISCALL)
-		a.mov(ecx, dword_ptr_abs(&pHook->m_pECX));
+	{
+		// A popped frame stays valid until the next frame is pushed
+		if (iFlags & BRIDGE_POST)
+			a.call((void *) &GetTopHookFrame);
+
+		a.mov(ecx, dword_ptr(eax, FRAME_OFFSET(m_pECX)));
+	}
 #endif
 
 	// Jump to the trampoline
 	a.jmp(pHook->m_pTrampoline);
 
+	if (!(iFlags & BRIDGE_PRE))
+		return a.make();
+
 	// This code will be executed if a pre-hook returns true
 	a.bind(label_override);
 
+	// Remove our frame from the hook stack and restore the original return
+	// address
+	a.call((void *) &PopHookFrame);
+	a.mov(ecx, eax);
+	a.mov(edx, dword_ptr(ecx, FRAME_OFFSET(m_pRetAddr)));
+	a.mov(dword_ptr(esp), edx);
+
 	// Use the new return value
 	Write_RestoreReturnValue(a, pHook);
 
@@ -34,8 +34,7 @@
 // ============================================================================
 // >> INCLUDES
 // ============================================================================
-#include <list>
-#include <map>
+#include <vector>
 
 namespace DynamicHooks {
 
@@ -89,10 +88,52 @@ enum Convention_t
 // ============================================================================
 struct Param_t
 {
-	char     m_cParam;
-	int      m_iOffset;
-	int      m_iSize;
-	Param_t* m_pNext;
+	char m_cParam;
+	int  m_iOffset;
+	int  m_iSize;
+};
+
+
+// ============================================================================
+// >> HookFrame_t
+// ============================================================================
+class CHook;
+
+/*
+	Every call of a hooked function pushes one of these onto a thread-local
+	stack, so hooks are safe under recursion and when they are entered by
+	multiple threads at the same time.
+*/
+struct HookFrame_t
+{
+	// The hook that has been entered
+	CHook* m_pHook;
+
+	// Stack pointer when the bridge was entered (points to m_pRetAddr)
+	void* m_pESP;
+
+	// Counter register. This will only be used on Windows
+	void* m_pECX;
+
+	// Contains the original return address
+	void* m_pRetAddr;
+
+	// This is the return register buffer (eax/edx or st0)
+	unsigned char m_pRetReg[8];
+};
+
+
+// ============================================================================
+// >> CallbackList_t
+// ============================================================================
+/*
+	An immutable list of callbacks. Adding or removing a callback publishes a
+	new list, so HookHandler can iterate over it without copying or locking.
+*/
+struct CallbackList_t
+{
+	int   m_iCount;
+	void* m_pCallbacks[1];
 };
 
 
@@ -112,7 +153,7 @@ public:
 	template<class T>
 	T GetReturnValue()
 	{
-		return *(T *) m_pRetReg;
+		return *(T *) GetHookFrame()->m_pRetReg;
 	}
 	
 	/*
@@ -121,7 +162,7 @@ public:
 	template<class T>
 	void SetReturnValue(T value)
 	{
-		*(T *) m_pRetReg = value;
+		*(T *) GetHookFrame()->m_pRetReg = value;
 	}
 	
 	/*
@@ -133,12 +174,14 @@ public:
 	template<class T>
 	T GetArgument(int iIndex)
 	{
+		HookFrame_t* pFrame = GetHookFrame();
+
 #ifdef _WIN32
 		if (m_eConvention == CONV_THISCALL && iIndex == 0)
-			return *(T *) &m_pECX;
+			return *(T *) &pFrame->m_pECX;
 #endif
 
-		unsigned long reg = ((unsigned long) m_pESP) + GetArgument(iIndex)->m_iOffset + 4;
+		unsigned long reg = ((unsigned long) pFrame->m_pESP) + m_pParams[iIndex].m_iOffset + 4;
 		return *(T *) reg;
 	}
 
@@ -151,20 +194,24 @@ public:
 	template<class T>
 	void SetArgument(int iIndex, T value)
 	{
+		HookFrame_t* pFrame = GetHookFrame();
+
 #ifdef _WIN32
 		if (m_eConvention == CONV_THISCALL && iIndex == 0)
 		{
-			m_pECX = *(void **) &value;
+			pFrame->m_pECX = *(void **) &value;
 			return;
 		}
 #endif
 
-		unsigned long reg = ((unsigned long) m_pESP) + GetArgument(iIndex)->m_iOffset + 4;
+		unsigned long reg = ((unsigned long) pFrame->m_pESP) + m_pParams[iIndex].m_iOffset + 4;
 		*(T *) reg = value;
 	}
 
 	/*
-		Adds a new callback to the callback list.
+		Adds a new callback to the callback list. Callbacks must only be
+		added or removed by one thread at a time, but hooks can be executed
+		by any thread meanwhile.
 	*/
 	void AddCallback(HookType_t eHookType, void* pCallback);
 
@@ -178,6 +225,19 @@ public:
 	*/
 	bool IsCallbackRegistered(HookType_t eHookType, void* pCallback);
 
+	/*
+		Publishes a new callback list for the given hook type. The old list
+		is freed as soon as no hook handler is running anymore.
+	*/
+	void PublishCallbacks(HookType_t eHookType, CallbackList_t* pList);
+
+	/*
+		Makes the bridge for the currently registered hook types active.
+		Bridges are created on demand and stay alive until the hook is
+		removed, because other threads might still execute them.
+	*/
+	void UpdateBridge();
+
 	/*
 		Returns the size you have to pop off from stack as a callee.
 	*/
@@ -186,29 +246,33 @@ public:
 	/*
 		Returns the number of arguments + this pointer (if it's a thiscall).
 	*/
-	int  GetArgumentCount();
+	int  GetArgumentCount()
+	{
+		return m_iArgumentCount;
+	}
 
 	/*
-		Returns a Param_t pointer for the given argument index.
+		Returns a Param_t pointer for the given argument index or NULL if the
+		index is out of range.
 	*/
-	Param_t* GetArgument(int iIndex);
-
-public:
-	// This is the return register buffer (eax and st0)
-	void* m_pRetReg;
-
-	// Stack pointer register buffer
-	void* m_pESP;
-
-	// Counter register. This will only be set on Windows
-	void* m_pECX;
+	Param_t* GetArgument(int iIndex)
+	{
+		if (iIndex < 0 || iIndex >= m_iArgumentCount)
+			return NULL;
 
-	// Contains the original return address
-	void* m_pRetAddr;
+		return &m_pParams[iIndex];
+	}
 
+	/*
+		Returns the innermost frame of this hook on the current thread's hook
+		stack or NULL if the current thread isn't executing this hook.
+	*/
+	HookFrame_t* GetHookFrame();
 
-	// Parameter struct
+public:
+	// Parameter array
 	Param_t* m_pParams;
+	int      m_iArgumentCount;
 
 	// Return type struct
 	Param_t* m_pRetParam;
@@ -217,9 +281,20 @@ public:
 	// Address of the trampoline
 	void* m_pTrampoline;
 
-	// Address of the bridge
+	// Address of the dispatcher. The hooked function jumps to it and it
+	// jumps to the active bridge.
 	void* m_pBridge;
 
+	// Address of the active bridge or the trampoline if no callbacks are
+	// registered. Exchanging it is atomic.
+	void* volatile m_pActiveBridge;
+
+	// Bridges for the combinations of hook types (see BRIDGE_* flags)
+	void* m_pBridges[4];
+
+	// Address of the code that is executed when the hooked function returns
+	void* m_pPostCallback;
+
 	// Address of the hooked function
 	void* m_pFunc;
 
@@ -231,8 +306,17 @@ public:
 	char* m_szParams;
 
 
-	// A map for all callbacks
-	std::map< HookType_t, std::list<void *> > m_Callbacks;
+	// The callbacks of every hook type or NULL if there are none
+	CallbackList_t* volatile m_pCallbacks[2];
+
+	// Number of hook handlers that are currently running and lists that
+	// have been replaced while a handler was running
+	volatile long                 m_iRunningHandlers;
+	std::vector<CallbackList_t *> m_RetiredCallbacks;
+
+	// Free to use by the owner of the hook. It's initialized with NULL and
+	// never touched by DynamicHooks.
+	void* m_pUserData;
 };
 
 
@@ -242,6 +326,8 @@ public:
 class CHookManager
 {
 public:
+	CHookManager();
+
 	/*
 		Hooks the given function and returns a new CHook instance. If the
 		function was already hooked, the existing CHook instance will be
@@ -264,8 +350,31 @@ public:
 	*/
 	void UnhookAllFunctions();
 
+	/*
+		Returns the number of hooked functions.
+	*/
+	int GetHookCount();
+
+	/*
+		Returns the hook at the given index. Hooks are sorted by the address
+		of the hooked function.
+	*/
+	CHook* GetHook(int iIndex);
+
+private:
+	/*
+		Returns the position of the hook for the given function or the
+		position where it would be inserted.
+	*/
+	std::vector<CHook *>::iterator LowerBound(void* pFunc);
+
 public:
-	std::list<CHook *> m_Hooks;
+	// All hooks sorted by the address of the hooked function
+	std::vector<CHook *> m_Hooks;
+
+	// Increased whenever a hook is created or removed. Code that caches hook
+	// data (e.g. trampoline addresses) can use it to detect outdated data.
+	unsigned int m_iGeneration;
 };
 
 
@@ -277,6 +386,21 @@ public:
 */
 CHookManager* GetHookManager();
 
+
+// ============================================================================
+// >> Hook stack
+// ============================================================================
+/*
+	Returns the number of frames on the current thread's hook stack.
+*/
+int GetHookFrameCount();
+
+/*
+	Returns the frame at the given depth of the current thread's hook stack.
+	0 is the innermost frame. Returns NULL if the depth is out of range.
+*/
+HookFrame_t* GetHookFrame(int iDepth = 0);
+
 } // namespace DynamicHooks
 
 #endif // _DYNAMIC_HOOKS_H
\ No newline at end of file
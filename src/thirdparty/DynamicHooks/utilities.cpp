@@ -81,11 +81,20 @@ int GetTypeSize(char cType)
 // ============================================================================
 // >> ParseParams
 // ============================================================================
-void ParseParams(Convention_t eConvention, char* szParams, Param_t* pParams, Param_t* pRetParam)
+int ParseParams(Convention_t eConvention, char* szParams, Param_t** ppParams, Param_t* pRetParam)
 {
-	Param_t* param = pParams;
-	char* ptr = szParams;
+	// Count the parameters first, so we can allocate the whole array at once
+	int count = 0;
+	char* ptr;
 	char ch;
+	for (ptr = szParams; (ch = *ptr) != '\0' && ch != ')'; ptr++)
+	{
+		if (ch != SIGCHAR_VOID)
+			count++;
+	}
+
+	Param_t* params = new Param_t[count];
+	int index = 0;
 	int offset = 0;
 
 #ifdef _WIN32
@@ -93,6 +102,7 @@ void ParseParams(Convention_t eConvention, char* szParams, Param_t* pParams, Par
 			offset -= sizeof(void *);
 #endif
 
+	ptr = szParams;
 	while ((ch = *ptr) != '\0' && ch != ')')
 	{
 		ptr++;
@@ -100,14 +110,12 @@ void ParseParams(Convention_t eConvention, char* szParams, Param_t* pParams, Par
 			continue;
 
 		int size = GetTypeSize(ch);
-		param->m_cParam = ch;
-		param->m_iOffset = offset;
-		param->m_iSize = size;
-		param = param->m_pNext = new Param_t;
+		params[index].m_cParam = ch;
+		params[index].m_iOffset = offset;
+		params[index].m_iSize = size;
+		index++;
 		offset += size;
 	}
-
-	param->m_pNext = NULL;
 	
 	if(ch == '\0')
 		ch = SIGCHAR_VOID;
@@ -117,7 +125,9 @@ void ParseParams(Convention_t eConvention, char* szParams, Param_t* pParams, Par
 	pRetParam->m_cParam  = ch;
 	pRetParam->m_iOffset = 0;
 	pRetParam->m_iSize   = GetTypeSize(ch);
-	pRetParam->m_pNext   = NULL;
+
+	*ppParams = params;
+	return count;
 }
 
 
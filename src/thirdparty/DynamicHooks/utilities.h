@@ -47,7 +47,13 @@ typedef bool (*HookFn)(DynamicHooks::HookType_t, DynamicHooks::CHook*);
 // >> FUNCTIONS
 // ============================================================================
 int  GetTypeSize(char cType);
-void ParseParams(DynamicHooks::Convention_t eConvention, char* szParams, DynamicHooks::Param_t* pParams, DynamicHooks::Param_t* pRetParam);
+
+/*
+	Allocates an array with a Param_t for every parameter and returns the
+	number of parameters. The array must be freed with delete[].
+*/
+int  ParseParams(DynamicHooks::Convention_t eConvention, char* szParams, DynamicHooks::Param_t** ppParams, DynamicHooks::Param_t* pRetParam);
+
 void SetMemPatchable(void* pAddr, unsigned int size);
 void WriteJMP(unsigned char* src, void* dest);
 
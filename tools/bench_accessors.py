@@ -0,0 +1,95 @@
+# =============================================================================
+# >> IMPORTS
+# =============================================================================
+# Python
+import os
+import sys
+import json
+import timeit
+
+# Run it from the repository root after build.sh/build.cmd created the
+# binutils package there
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+
+from binutils import alloc
+
+
+# =============================================================================
+# >> CONSTANTS
+# =============================================================================
+# Number of calls per measurement. The best of REPEAT measurements is used
+NUMBER = 1000000
+REPEAT = 5
+
+# Statement name -> statement. Every statement is a single call, so the
+# results are nanoseconds per call
+STATEMENTS = [
+    ('get_int',           'ptr.get_int(4)'),
+    ('get_int(offset=)',  'ptr.get_int(offset=4)'),
+    ('set_int',           'ptr.set_int(5, 4)'),
+    ('get_float',         'ptr.get_float(8)'),
+    ('set_float',         'ptr.set_float(1.5, 8)'),
+    ('get_ptr',           'ptr.get_ptr(0)'),
+    ('IntArray[i]',       'array[3]'),
+    ('IntArray[i] = v',   'array[3] = 5'),
+
+    # Still dispatched by boost.python. Shows the overhead the accessors
+    # don't pay anymore
+    ('Pointer.__int__',   'ptr.__int__()'),
+]
+
+
+# =============================================================================
+# >> FUNCTIONS
+# =============================================================================
+def run():
+    '''
+    Returns a dict with the nanoseconds per call of every statement.
+    '''
+
+    # The statements import them from __main__
+    global ptr, array
+    ptr = alloc(64)
+    array = ptr.make_int_array(16)
+
+    results = {}
+    for name, statement in STATEMENTS:
+        best = min(timeit.repeat(statement, 'from __main__ import ptr, array',
+            repeat=REPEAT, number=NUMBER))
+
+        results[name] = best / NUMBER * 1e9
+
+    ptr.dealloc()
+    return results
+
+def main():
+    '''
+    Usage: bench_accessors.py [--save FILE] [--compare FILE]
+
+    --save stores the results, so a build of the old boost.python accessors
+    can be compared with the current one by running --compare with the new
+    build.
+    '''
+
+    args = sys.argv[1:]
+    results = run()
+
+    baseline = {}
+    if '--compare' in args:
+        with open(args[args.index('--compare') + 1]) as f:
+            baseline = json.load(f)
+
+    for name, statement in STATEMENTS:
+        line = '%-20s %8.1f ns'% (name, results[name])
+        if name in baseline:
+            line += '   baseline %8.1f ns   %5.2fx'% (baseline[name],
+                baseline[name] / results[name])
+
+        print(line)
+
+    if '--save' in args:
+        with open(args[args.index('--save') + 1], 'w') as f:
+            json.dump(results, f, indent=4)
+
+if __name__ == '__main__':
+    main()